@@ -0,0 +1,235 @@
+#include "../defclique/defclique.h"
+#include "../kdbb/kdbb.h"
+#include "../utils/cmdline.hpp"
+#include "../utils/log.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Runs the solvers over a matrix of datasets, values of k and repeats, and
+// writes the phase times of every run as JSON, to compare versions.
+
+struct Dataset {
+	std::string name, path;
+	Graph G;
+	long loadTime;
+};
+
+static std::vector<std::string> split(const std::string &s, char sep) {
+	std::vector<std::string> res;
+	size_t begin = 0, end;
+	do {
+		end = s.find(sep, begin);
+		res.push_back(s.substr(begin, end - begin));
+		begin = end + 1;
+	} while (end != std::string::npos);
+	return res;
+}
+
+// Writes the graph described by spec to a temporary file and returns its path:
+//   gen:er:<n>:<avg degree>:<seed>				random graph
+//   gen:planted:<n>:<avg degree>:<size>:<seed>	random graph with a planted
+//												clique missing size/4 edges
+static std::string generate(const std::string &spec) {
+	std::vector<std::string> f = split(spec, ':');
+	bool planted = f.size() == 6 && f[1] == "planted";
+	if (!planted && !(f.size() == 5 && f[1] == "er")) {
+		log("Unknown generated graph: %s", spec.c_str());
+		return "";
+	}
+
+	// Non-negative integer fields, -1 where there is none
+	std::vector<long> x;
+	for (size_t i = 2; i < f.size(); ++i) {
+		char *end;
+		errno = 0;
+		long v = strtol(f[i].c_str(), &end, 10);
+		x.push_back(f[i].empty() || *end != '\0' || v < 0 || errno == ERANGE ? -1 : v);
+	}
+	if (std::count(x.begin(), x.end(), -1) > 0 || x[0] < 1 || x[0] > INT_MAX) {
+		log("Invalid generated graph: %s", spec.c_str());
+		return "";
+	}
+
+	int n = x[0];
+	if (x[1] > n-1) {
+		log("Invalid generated graph: %s, the average degree exceeds n-1", spec.c_str());
+		return "";
+	}
+	long m = x[1] * n / 2;
+	if (planted && x[2] > n) {
+		log("Invalid generated graph: %s, the planted clique exceeds n", spec.c_str());
+		return "";
+	}
+	int size = planted ? x[2] : 0;
+	std::mt19937 rng(x.back());
+
+	std::set<std::pair<int, int>> E;
+	auto addEdge = [&](int u, int v) {
+		if (u != v) E.insert(std::make_pair(std::min(u, v), std::max(u, v)));
+	};
+
+	std::uniform_int_distribution<int> vertex(0, n-1);
+	while (E.size() < m) addEdge(vertex(rng), vertex(rng));
+
+	if (planted) {
+		std::vector<int> P(n);
+		for (int v = 0; v < n; ++v) P[v] = v;
+		std::shuffle(P.begin(), P.end(), rng);
+		P.resize(size);
+		for (int i = 0; i < size; ++i)
+			for (int j = i+1; j < size; ++j)
+				addEdge(P[i], P[j]);
+		std::uniform_int_distribution<int> member(0, size-1);
+		for (int i = 0; i < size/4; ++i) {
+			int u = P[member(rng)], v = P[member(rng)];
+			E.erase(std::make_pair(std::min(u, v), std::max(u, v)));
+		}
+	}
+
+	std::string path = std::string(P_tmpdir) + "/defclique-" + f[1];
+	for (size_t i = 2; i < f.size(); ++i) path += "-" + f[i];
+	path += ".txt";
+
+	FILE *fp = fopen(path.c_str(), "w");
+	if (fp == nullptr) {
+		log("Unable to write generated graph %s", path.c_str());
+		return "";
+	}
+	fprintf(fp, "%d %d\n", n, (int)E.size());
+	for (auto &e : E) fprintf(fp, "%d %d\n", e.first, e.second);
+	fclose(fp);
+
+	return path;
+}
+
+int main(int argc, char* argv[]) {
+
+	cmdline::parser args;
+
+	args.add<std::string>("data", 'd', "comma-separated datasets, or generated graphs gen:er:<n>:<deg>:<seed> and gen:planted:<n>:<deg>:<size>:<seed>",
+		false, "datas/tech-WHOIS,datas/ia-enron-large,gen:er:20000:20:1,gen:planted:20000:20:40:1");
+	args.add<std::string>("algo", 'a', "comma-separated algorithms", false, "MDC,RussianDoll,KDBB");
+	args.add<std::string>("key", 'k', "comma-separated values of k", false, "1,3,5");
+	args.add<int>("repeats", 'r', "runs of each configuration", false, 3);
+	args.add<long>("time-limit", '\0', "time limit of each run in ms, 0 for no limit", false, 10000);
+	args.add<std::string>("output", 'o', "JSON output file", false, "bench.json");
+
+	args.parse_check(argc, argv);
+
+	auto algos = split(args.get<std::string>("algo"), ',');
+	auto keyList = split(args.get<std::string>("key"), ',');
+	int repeats = args.get<int>("repeats");
+	long timeLimit = args.get<long>("time-limit");
+	auto output = args.get<std::string>("output");
+
+	for (auto &algo : algos)
+		if (algo != "MDC" && algo != "RussianDoll" && algo != "KDBB") {
+			log("Unknown algorithm: %s", algo.c_str());
+			return 1;
+		}
+
+	std::vector<int> keys;
+	for (auto &key : keyList) {
+		char *end;
+		errno = 0;
+		long k = strtol(key.c_str(), &end, 10);
+		if (key.empty() || *end != '\0' || k < 0 || k > INT_MAX || errno == ERANGE) {
+			log("Invalid value of k: %s", key.c_str());
+			return 1;
+		}
+		keys.push_back(k);
+	}
+
+	FILE *out = fopen(output.c_str(), "w");
+	if (out == nullptr) {
+		log("Unable to write %s", output.c_str());
+		return 1;
+	}
+
+	fprintf(out, "{\n  \"repeats\": %d,\n  \"time_limit_ms\": %ld,\n  \"runs\": [", repeats, timeLimit);
+
+	bool first = true;
+
+	for (auto &spec : split(args.get<std::string>("data"), ',')) {
+
+		Dataset D;
+		D.name = spec;
+		D.path = spec.compare(0, 4, "gen:") == 0 ? generate(spec) : spec;
+		if (D.path.empty()) continue;
+
+		auto loadStartTimePoint = std::chrono::steady_clock::now();
+		D.G.loadFromFile(D.path);
+		D.loadTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - loadStartTimePoint).count();
+
+		for (auto &algo : algos) for (int k : keys) for (int r = 0; r < repeats; ++r) {
+
+			log("********** Bench: %s, %s, k=%d, run %d/%d **********",
+				D.name.c_str(), algo.c_str(), k, r+1, repeats);
+
+			auto startTimePoint = std::chrono::steady_clock::now();
+
+			defclique::Stats stats;
+			long loadTime = D.loadTime;
+			int size;
+			bool optimal;
+
+			if (algo == "KDBB") {
+				kdbb::Stats kstats;
+				kdbb::Result res = kdbb::run(D.path, k, timeLimit, &kstats);
+				size = res.Ss.size();
+				optimal = res.optimal;
+				loadTime = kstats.loadTime;
+				stats.heuristicTime = kstats.heuristicTime;
+				stats.reductionTime = kstats.reductionTime;
+				stats.branchTime = kstats.branchTime;
+				stats.numNodes = kstats.numNodes;
+			}
+			else {
+				defclique::Options opt;
+				opt.timeLimit = timeLimit;
+				defclique::timer.start(timeLimit);
+				defclique::Result res = defclique::solve(D.G, k, algo == "MDC" ? REDUCTION_SEARCH : RUSSIANDOLL_SEARCH, opt);
+				size = res.Ss.size();
+				optimal = res.optimal;
+				stats = res.stats;
+			}
+
+			long total = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - startTimePoint).count();
+
+			// KDBB does not split out the ordering and the per-root preprocessing
+			bool phases = algo != "KDBB";
+
+			fprintf(out, "%s\n    {\"dataset\": %s, \"n\": %d, \"m\": %d, \"algo\": \"%s\", \"k\": %d, \"repeat\": %d, "
+				"\"load_ms\": %ld, \"heuristic_ms\": %ld, \"reduction_ms\": %ld, ",
+				first ? "" : ",", defclique::jsonString(D.name).c_str(), D.G.V.size(), D.G.m, algo.c_str(), k, r,
+				loadTime, stats.heuristicTime, stats.reductionTime);
+			if (phases)
+				fprintf(out, "\"ordering_ms\": %ld, \"preprocess_ms\": %ld, ", stats.orderingTime, stats.preprocessTime);
+			else
+				fprintf(out, "\"ordering_ms\": null, \"preprocess_ms\": null, ");
+			fprintf(out, "\"branch_ms\": %ld, \"total_ms\": %ld, \"nodes\": %lld, \"size\": %d, \"optimal\": %s}",
+				stats.branchTime, total, stats.numNodes, size, optimal ? "true" : "false");
+			fflush(out);
+
+			first = false;
+		}
+	}
+
+	fprintf(out, "\n  ]\n}\n");
+	fclose(out);
+
+	log("Benchmark written to %s", output.c_str());
+
+	return 0;
+}
@@ -0,0 +1,380 @@
+#include "../defclique/defclique.h"
+#include "../utils/cmdline.hpp"
+#include "../utils/intersect.hpp"
+#include "../utils/linearheap.hpp"
+#include "../utils/log.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+// Times the inner-loop primitives of the solvers in isolation, with the
+// access patterns of the largest two-hop sub-problem of a real graph.
+//
+// Misses are estimated by running the same operation on a working set that
+// stays in L1 ("hot"); the extra time per op divided by the latency of a
+// dependent load from memory approximates the cache misses per op.
+
+static volatile long long sink;
+
+static int repeats;
+
+// Best time per op in ns over the repeats
+static double measure(long long ops, const std::function<long long()> &body) {
+	double best = 1e300;
+	for (int r = 0; r < repeats; ++r) {
+		auto startTimePoint = std::chrono::steady_clock::now();
+		sink += body();
+		double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - startTimePoint).count();
+		best = std::min(best, ns / std::max(ops, 1ll));
+	}
+	return best;
+}
+
+// Latency of a dependent load from a buffer much larger than the caches
+static double memoryLatency() {
+	const int n = 1 << 24;	// 64 MB
+	std::vector<int> next(n), perm(n);
+	std::iota(perm.begin(), perm.end(), 0);
+	std::shuffle(perm.begin()+1, perm.end(), std::mt19937(1));
+	for (int i = 0; i < n; ++i) next[perm[i]] = perm[(i+1) % n];
+	const long long steps = 1 << 22;
+	return measure(steps, [&]() {
+		int p = 0;
+		for (long long i = 0; i < steps; ++i) p = next[p];
+		return (long long)p;
+	});
+}
+
+static double latency;
+
+static void report(const char *name, double ns, double kb, double hotNs = -1) {
+	if (hotNs < 0)
+		printf("%-44s %9.2f ns/op %12.1f KB %14s\n", name, ns, kb, "-");
+	else
+		printf("%-44s %9.2f ns/op %12.1f KB %8.3f miss/op\n", name, ns, kb, std::max(0.0, ns - hotNs) / latency);
+}
+
+int main(int argc, char* argv[]) {
+
+	cmdline::parser args;
+
+	args.add<std::string>("data", 'd', "dataset path", false, "datas/tech-WHOIS");
+	args.add<int>("key", 'k', "value of k used to build the sub-problem", false, 3);
+	args.add<int>("repeats", 'r', "runs of each benchmark, the best is reported", false, 5);
+
+	args.parse_check(argc, argv);
+
+	int k = args.get<int>("key");
+	repeats = args.get<int>("repeats");
+
+	Graph G(args.get<std::string>("data"));
+
+	// The largest sub-problem the search builds, as in solve
+	defclique::Context ctx;
+	ctx.Sub.shareAdjacency(G);
+	ctx.reserve(G.n);
+	ctx.Ss = defclique::heuristic(G, k);
+	defclique::k = k;
+
+	Graph Core = defclique::coreReduction(G, ctx.Ss.size() >= k+1 ? ctx.Ss.size()-k : 0);
+	Ordering o;
+	o.degeneracyOrdering(Core);
+
+	int root = -1, best = 0;
+	for (int i = 0; i < o.numOrdered; ++i) {
+		ctx.preprocessing(Core, o, o.ordered[i], TWO_HOP);
+		if (ctx.C.size() > best) {
+			best = ctx.C.size();
+			root = o.ordered[i];
+		}
+	}
+	if (best < 16) {
+		log("No sub-problem large enough to benchmark");
+		return 1;
+	}
+	ctx.preprocessing(Core, o, root, TWO_HOP);
+
+	std::vector<int> P(ctx.Sub.V.begin(), ctx.Sub.V.end());
+	std::vector<int> C(ctx.C.begin(), ctx.C.end());
+	long long subEdges = ctx.Sub.m;
+
+	log("Graph: n=%d, m=%d; sub-problem of root %d: n=%d, m=%lld",
+		G.V.size(), G.m, root, (int)P.size(), subEdges);
+
+	printf("%-44s %15s %15s %16s\n", "benchmark", "time", "working set", "est. misses");
+
+	latency = memoryLatency();
+	printf("%-44s %9.2f ns/load\n", "memory latency (pointer chase, 64 MB)", latency);
+
+	// Graph::connect, i.e. CuckooHash::find, on all pairs of the sub-problem,
+	// as in subGraph and updateC
+	{
+		long long ops = (long long)P.size() * (P.size()-1) / 2;
+		double ns = measure(ops, [&]() {
+			long long cnt = 0;
+			for (int i = 0; i < P.size(); ++i)
+				for (int j = i+1; j < P.size(); ++j)
+					cnt += G.connect(P[i], P[j]);
+			return cnt;
+		});
+		double hot = measure(ops, [&]() {
+			long long cnt = 0;
+			for (long long i = 0; i < ops; ++i)
+				cnt += G.connect(P[i & 7], P[8 + (i >> 3 & 7)]);
+			return cnt;
+		});
+		double kb = 0;
+		for (int v : P) kb += G.nbrMap[v].getcapacity() * sizeof(int) / 1024.0;
+		report("CuckooHash::find (sub-problem pairs)", ns, kb, hot);
+	}
+
+	// Graph::connectMask on the same pairs, up to 64 at a time, as in
+	// preprocessing, updateC and the pivot scan
+	{
+		long long ops = (long long)P.size() * (P.size()-1) / 2;
+		double ns = measure(ops, [&]() {
+			long long cnt = 0;
+			for (int i = 0; i < P.size(); ++i)
+				for (int j = i+1; j < P.size(); j += 64)
+					cnt += __builtin_popcountll(G.connectMask(P[i], &P[j], std::min(64, (int)P.size()-j)));
+			return cnt;
+		});
+		double kb = 0;
+		for (int v : P) kb += G.nbrMap[v].getcapacity() * sizeof(int) / 1024.0;
+		report("Graph::connectMask (sub-problem pairs)", ns, kb);
+	}
+
+	// Graph::connect on random pairs of the whole graph
+	{
+		std::vector<int> V(G.V.begin(), G.V.end());
+		std::mt19937 rng(1);
+		std::uniform_int_distribution<int> pick(0, V.size()-1);
+		const int ops = 1 << 20;
+		std::vector<int> U(ops), W(ops);
+		for (int i = 0; i < ops; ++i) { U[i] = V[pick(rng)]; W[i] = V[pick(rng)]; }
+		double ns = measure(ops, [&]() {
+			long long cnt = 0;
+			for (int i = 0; i < ops; ++i) cnt += G.connect(U[i], W[i]);
+			return cnt;
+		});
+		double hot = measure(ops, [&]() {
+			long long cnt = 0;
+			for (int i = 0; i < ops; ++i) cnt += G.connect(U[i & 7], W[i & 7]);
+			return cnt;
+		});
+		double kb = 0;
+		for (int v : V) kb += G.nbrMap[v].getcapacity() * sizeof(int) / 1024.0;
+		report("CuckooHash::find (random pairs)", ns, kb, hot);
+	}
+
+	// The same queries on WideCuckooHash tables of G
+	{
+		std::vector<WideCuckooHash> wide(G.n);
+		double ns = measure(2ll * G.m, [&]() {
+			for (int v : G.V) {
+				wide[v].clear();
+				wide[v].reserve(G.nbr[v].size());
+				for (int w : G.nbr[v]) wide[v].insert(w);
+			}
+			return (long long)wide[P[0]].getsize();
+		});
+		double kb = 0, kbSub = 0;
+		for (int v : G.V) kb += wide[v].memory() / 1024.0;
+		for (int v : P) kbSub += wide[v].memory() / 1024.0;
+		report("WideCuckooHash::insert (whole graph)", ns, kb);
+
+		long long ops = (long long)P.size() * (P.size()-1) / 2;
+		ns = measure(ops, [&]() {
+			long long cnt = 0;
+			for (int i = 0; i < P.size(); ++i)
+				for (int j = i+1; j < P.size(); ++j)
+					cnt += wide[P[i]].find(P[j]);
+			return cnt;
+		});
+		double hot = measure(ops, [&]() {
+			long long cnt = 0;
+			for (long long i = 0; i < ops; ++i)
+				cnt += wide[P[i & 7]].find(P[8 + (i >> 3 & 7)]);
+			return cnt;
+		});
+		report("WideCuckooHash::find (sub-problem pairs)", ns, kbSub, hot);
+
+		std::vector<int> V(G.V.begin(), G.V.end());
+		std::mt19937 rng(1);
+		std::uniform_int_distribution<int> pick(0, V.size()-1);
+		const int randomOps = 1 << 20;
+		std::vector<int> U(randomOps), W(randomOps);
+		for (int i = 0; i < randomOps; ++i) { U[i] = V[pick(rng)]; W[i] = V[pick(rng)]; }
+		ns = measure(randomOps, [&]() {
+			long long cnt = 0;
+			for (int i = 0; i < randomOps; ++i) cnt += wide[U[i]].find(W[i]);
+			return cnt;
+		});
+		hot = measure(randomOps, [&]() {
+			long long cnt = 0;
+			for (int i = 0; i < randomOps; ++i) cnt += wide[U[i & 7]].find(W[i & 7]);
+			return cnt;
+		});
+		report("WideCuckooHash::find (random pairs)", ns, kb, hot);
+	}
+
+	// Building both tables from the whole graph, and from ids that share
+	// their low bits, e.g. the vertices of a grid or of a shifted id range
+	{
+		std::vector<CuckooHash> narrow(G.n);
+		double ns = measure(2ll * G.m, [&]() {
+			for (int v : G.V) {
+				narrow[v].clear();
+				narrow[v].reserve(G.nbr[v].size());
+				for (int w : G.nbr[v]) narrow[v].insert(w);
+			}
+			return (long long)narrow[P[0]].getsize();
+		});
+		double kb = 0;
+		for (int v : G.V) kb += narrow[v].memory() / 1024.0;
+		report("CuckooHash::insert (whole graph)", ns, kb);
+
+		const int keys = 4096;
+		CuckooHash h;
+		ns = measure(keys, [&]() {
+			h = CuckooHash();
+			for (int i = 0; i < keys; ++i) h.insert(i << 10);
+			return (long long)h.getsize();
+		});
+		report("CuckooHash::insert (ids i*1024)", ns, h.memory() / 1024.0);
+		WideCuckooHash w;
+		ns = measure(keys, [&]() {
+			w = WideCuckooHash();
+			for (int i = 0; i < keys; ++i) w.insert(i << 10);
+			return (long long)w.getsize();
+		});
+		report("WideCuckooHash::insert (ids i*1024)", ns, w.memory() / 1024.0);
+	}
+
+	// Common neighbours of every edge of the core, as in edgeReduction, by
+	// probing the hash table of one end or intersecting the sorted lists
+	{
+		std::vector<long long> offset;
+		std::vector<int> adj;
+		sortedAdjacency(Core, offset, adj);
+		std::vector<std::pair<int, int>> edges;
+		for (int u : Core.V)
+			for (int v : Core.nbr[u])
+				if (u < v) edges.push_back(std::make_pair(u, v));
+		double kb = (adj.size() * sizeof(int) + offset.size() * sizeof(long long)) / 1024.0;
+		report("common nbrs: CuckooHash probes (per edge)", measure(edges.size(), [&]() {
+			long long cnt = 0;
+			for (auto &e : edges) {
+				int u = e.first, v = e.second;
+				if (Core.nbr[u].size() > Core.nbr[v].size()) std::swap(u, v);
+				for (int w : Core.nbr[u]) cnt += Core.connect(v, w);
+			}
+			return cnt;
+		}), Core.nbrMapMemory() / 1024.0);
+		auto kernel = [&](const char *name, int (*count)(const int *, int, const int *, int, int *)) {
+			report(name, measure(edges.size(), [&]() {
+				long long cnt = 0;
+				for (auto &e : edges) {
+					int u = e.first, v = e.second;
+					cnt += count(adj.data() + offset[u], offset[u+1] - offset[u], adj.data() + offset[v], offset[v+1] - offset[v], nullptr);
+				}
+				return cnt;
+			}), kb);
+		};
+		kernel("common nbrs: merge (per edge)", intersectMerge<false>);
+		kernel("common nbrs: gallop (per edge)", intersectGallop<false>);
+		kernel("common nbrs: SSE blocks (per edge)", intersectSSE<false>);
+		if (cpuHasAVX2()) kernel("common nbrs: AVX2 blocks (per edge)", intersectAVX2<false>);
+		kernel("common nbrs: intersectCount (per edge)", intersectAuto<false>);
+	}
+
+	// VertexSet::pop/push of every candidate, as in moveCToS and moveSToC
+	{
+		VertexSet &S = ctx.C;
+		long long ops = 2ll * C.size() * 64;
+		double ns = measure(ops, [&]() {
+			for (int r = 0; r < 64; ++r)
+				for (int v : C) { S.pop(v); S.push(v); }
+			return (long long)S.size();
+		});
+		double hot = measure(ops, [&]() {
+			for (int r = 0; r < 64; ++r)
+				for (int i = 0; i < C.size(); ++i) { S.pop(C[0]); S.push(C[0]); }
+			return (long long)S.size();
+		});
+		report("VertexSet::pop/push (candidates)", ns, 2.0 * G.n * sizeof(int) / 1024.0, hot);
+	}
+
+	// Degree updates scattered over the neighbours, as in add and sub
+	{
+		long long ops = 0;
+		for (int v : C) ops += 2 * ctx.Sub.nbr[v].size();
+		double ns = measure(ops, [&]() {
+			for (int v : C) {
+				defclique::sub(ctx.Sub, ctx.C, ctx.degC, v);
+				defclique::add(ctx.Sub, ctx.C, ctx.degC, v);
+			}
+			return (long long)ctx.degC[C[0]];
+		});
+		int v0 = C[0];
+		for (int v : C)
+			if (ctx.Sub.nbr[v].size() > ctx.Sub.nbr[v0].size()) v0 = v;
+		long long hotOps = 2 * ctx.Sub.nbr[v0].size() * C.size();
+		double hot = measure(hotOps, [&]() {
+			for (int i = 0; i < C.size(); ++i) {
+				defclique::sub(ctx.Sub, ctx.C, ctx.degC, v0);
+				defclique::add(ctx.Sub, ctx.C, ctx.degC, v0);
+			}
+			return (long long)ctx.degC[v0];
+		});
+		report("add/sub degree scatter (per neighbour)", ns, (2.0 * subEdges + G.n) * sizeof(int) / 1024.0, hot);
+	}
+
+	// LinearHeap::dec while peeling the whole graph, as in degeneracyOrdering
+	{
+		LinearHeap heap;
+		long long ops = 0;
+		double ns = measure(1, [&]() {
+			heap.build(G.V, [&](int v) { return (int)G.nbr[v].size(); });
+			ops = 0;
+			while (!heap.empty()) {
+				int u = heap.top();
+				heap.pop();
+				for (int v : G.nbr[u]) {
+					if (heap[v] <= heap[u]) continue;
+					if (heap.inside(v)) { heap.dec(v); ++ops; }
+				}
+			}
+			return ops;
+		});
+		report("LinearHeap::dec (degeneracy peeling)", ns / std::max(ops, 1ll), 5.0 * G.n * sizeof(int) / 1024.0);
+	}
+
+	// Graph::subGraph of the sub-problem, as in preprocessing
+	{
+		Graph H;
+		double ns = measure(subEdges, [&]() {
+			H.subGraph(G, ctx.S, ctx.C);
+			return (long long)H.m;
+		});
+		report("Graph::subGraph (per edge)", ns, 2.0 * subEdges * sizeof(int) / 1024.0);
+	}
+
+	// Coloring::graphColoring of the sub-problem, before each branch
+	{
+		Coloring clr;
+		double ns = measure(P.size(), [&]() {
+			clr.graphColoring(ctx.Sub, ctx.Ss.size()-k+1);
+			return (long long)clr.numColors;
+		});
+		report("Coloring::graphColoring (per vertex)", ns, (2.0 * subEdges + 3.0 * P.size()) * sizeof(int) / 1024.0);
+	}
+
+	return 0;
+}
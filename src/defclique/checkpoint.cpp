@@ -0,0 +1,38 @@
+#include "checkpoint.h"
+#include <cstdio>
+#include <cinttypes>
+
+bool defclique::Checkpoint::load(const std::string &filename, int n) {
+	FILE *f = fopen(filename.c_str(), "r");
+	if (f == nullptr) return false;
+
+	int size = 0;
+	bool ok = fscanf(f, "defclique-checkpoint %" SCNu64 " %d %d %d %d %d", 
+		&fingerprint, &k, &mode, &coreBound, &next, &size) == 6;
+
+	if (size < 0 || size > n) ok = false;
+	Ss.resize(ok ? size : 0);
+	for (int i = 0; ok && i < size; ++i)
+		ok = fscanf(f, "%d", &Ss[i]) == 1;
+
+	fclose(f);
+	return ok;
+}
+
+bool defclique::Checkpoint::save(const std::string &filename) const {
+	// Write to a temporary file first so that a preempted job never leaves
+	// a truncated checkpoint behind
+	std::string tmp = filename + ".tmp";
+	FILE *f = fopen(tmp.c_str(), "w");
+	if (f == nullptr) return false;
+
+	fprintf(f, "defclique-checkpoint %" PRIu64 " %d %d %d %d %d\n", 
+		fingerprint, k, mode, coreBound, next, (int)Ss.size());
+	for (int i = 0; i < Ss.size(); ++i)
+		fprintf(f, i > 0 ? " %d" : "%d", Ss[i]);
+	fprintf(f, "\n");
+
+	bool ok = fflush(f) == 0;
+	ok = fclose(f) == 0 && ok;
+	return ok && rename(tmp.c_str(), filename.c_str()) == 0;
+}
@@ -0,0 +1,24 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace defclique {
+
+	// Progress of the root-by-root search. The root ordering is a function of
+	// the core, which is rebuilt from coreBound, so the next root index and
+	// S* are enough to resume the search on the same graph.
+	struct Checkpoint {
+		uint64_t fingerprint;
+		int k, mode, coreBound, next;
+		std::vector<int> Ss;
+
+		// Fails unless S* holds at most n vertices
+		bool load(const std::string &filename, int n);
+		bool save(const std::string &filename) const;
+	};
+}
+
+#endif // CHECKPOINT_H
@@ -1,13 +1,22 @@
 #include "defclique.h"
+#include "checkpoint.h"
 #include "../utils/ordering.hpp"
 #include "../utils/coloring.hpp"
 #include "../utils/log.hpp"
+#include "../utils/trace.hpp"
+#include "../utils/perf.hpp"
+#include "../utils/progress.hpp"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstring>
 #include <ratio>
 #include <vector>
 #include <cstdio>
 #include <sstream>
+#include <random>
+#include <sys/resource.h>
+#include <unistd.h>
 
 //#define EDGE_REDUCTION
 #define DEBUG_RESULT
@@ -16,14 +25,9 @@
 
 
 namespace defclique {
-	int k, nnbS;
-    // long long nnbSub;
-	Graph Sub;
-	Coloring clr;
-	VertexSet S, C, Ss, C1, D;
-	std::vector<int> degC1, degC, degS, cnD;
-	std::vector<int> q;
-	int mode;
+	int k, mode;
+	Timer timer;
+	std::function<void(VertexSet &, const std::string &)> onIncumbent;
 }
 
 void defclique::logSet(VertexSet &V, const std::string &name) {
@@ -40,16 +44,30 @@ void defclique::logSet(VertexSet &V, const std::string &name) {
 		name.c_str(), V.size(), ss.str().c_str());
 }
 
+void defclique::logIncumbent(VertexSet &V, const std::string &phase) {
+	log("New S*: size=%d, phase=%s, time=%ld ms", V.size(), phase.c_str(), timer.elapsed());
+	if (onIncumbent) onIncumbent(V, phase);
+}
+
+// V with the vertices of a relabelled graph renamed to their original ids
+static VertexSet originalIds(const VertexSet &V, const std::vector<int> &label) {
+	VertexSet res(label.size());
+	for (int v : V) res.push(label[v]);
+	return res;
+}
+
 Graph defclique::coreReduction(Graph& G, int k) {
 	if (k <= 1) return G;
 
+	TraceSpan span("coreReduction");
+
 	log("Running core reduction with k=%d...", k);
 
 	auto startTimePoint = std::chrono::steady_clock::now();
 
 	int head = 0, tail = 0;
 	std::vector<bool> vis(G.n);
-	std::vector<int> deg(G.n);
+	std::vector<int> deg(G.n), q(G.n);
 
 	for (int u : G.V) {
 		deg[u] = G.nbr[u].size();
@@ -70,16 +88,19 @@ Graph defclique::coreReduction(Graph& G, int k) {
 		}
 	}
 
-	Graph C;
+	std::vector<std::pair<int, int>> edges;
 
 	for (int u : G.V) {
 		if (vis[u]) continue;
 		for (int v : G.nbr[u]) {
 			if (vis[v]) continue;
-			C.addEdge(u, v);
+			edges.push_back(std::make_pair(u, v));
 		}
 	}
 
+	Graph C;
+	C.build(0, edges);
+
 	auto duration = std::chrono::duration_cast<std::chrono::milliseconds> (
 		std::chrono::steady_clock::now() - startTimePoint);
 
@@ -91,6 +112,8 @@ Graph defclique::coreReduction(Graph& G, int k) {
 
 Graph defclique::edgeReduction(Graph &G, int k) {
 
+	TraceSpan span("edgeReduction");
+
 	log("Running edge reduction with k=%d...", k);
 
 	auto startTimePoint = std::chrono::steady_clock::now();
@@ -106,7 +129,7 @@ Graph defclique::edgeReduction(Graph &G, int k) {
 
 	auto countCommonNeighbor = [&](int u, int v) {
 		int cnt = 0;
-		if (G.nbr[u] > G.nbr[v]) std::swap(u, v);
+		if (G.nbr[u].size() > G.nbr[v].size()) std::swap(u, v);
 		for (int w : G.nbr[u])
 			if (G.connect(v, w))
 				++cnt;
@@ -117,7 +140,7 @@ Graph defclique::edgeReduction(Graph &G, int k) {
 		vis[id] = true;
 		// cn[id] = 0;
 		int u = edges[id].first, v = edges[id].second;
-		if (G.nbr[u] > G.nbr[v]) std::swap(u, v);
+		if (G.nbr[u].size() > G.nbr[v].size()) std::swap(u, v);
 		for (int w : G.nbr[u])
 			if (G.connect(v, w)) {
 				int i = eid[u][w], j = eid[v][w];
@@ -142,7 +165,7 @@ Graph defclique::edgeReduction(Graph &G, int k) {
 	while (head < tail) {
 		int i = q[head++];
 		int u = edges[i].first, v = edges[i].second;
-		if (G.nbr[u] > G.nbr[v]) std::swap(u, v);
+		if (G.nbr[u].size() > G.nbr[v].size()) std::swap(u, v);
 		for (int w : G.nbr[u]) {
 			if (G.connect(v, w)) {
 				int i = eid[u][w], j = eid[v][w];
@@ -158,24 +181,50 @@ Graph defclique::edgeReduction(Graph &G, int k) {
 		}
 	}
 
-	Graph E;
+	std::vector<std::pair<int, int>> kept;
 
 	for (int i = 0; i < edges.size(); ++i) {
 		if (vis[i]) continue;
-		E.addEdge(edges[i].first, edges[i].second);
+		kept.push_back(edges[i]);
 	}
 
+	Graph E;
+	E.build(0, kept);
+
 	auto duration = std::chrono::duration_cast<std::chrono::milliseconds> (
 		std::chrono::steady_clock::now() - startTimePoint);
 
-	log("Edge reduction done! Time spent: %ld ms", duration.count());
+	size_t buffers = (cn.capacity() + q.capacity()) * sizeof(int) + edges.capacity() * sizeof(edges[0]) + vis.capacity() / 8;
+	for (auto &m : eid)	// nodes of two pointers and the pair, plus the buckets
+		buffers += m.size() * (sizeof(std::pair<int, int>) + 2 * sizeof(void*)) + m.bucket_count() * sizeof(void*);
+	log("Edge reduction done! Time spent: %ld ms, buffers: %.1f MB", duration.count(), buffers / 1048576.0);
 	log("Before: n=%d, m=%d; After: n=%d, m=%d", G.V.size(), G.m, E.V.size(), E.m);
 
 	return E;
 
 }
 
-void defclique::preprocessing(Graph &G, Ordering &o, int u, int mode) {
+void defclique::Context::reserve(int n) {
+	Sub.resize(n);
+	S.reserve(n);
+	C.reserve(n);
+	C1.reserve(n);
+	D.reserve(n);
+	Ss.reserve(n);
+
+	degS.resize(n);
+	degC.resize(n);
+	degC1.resize(n);
+	cnD.resize(n);
+	q.resize(n);
+	degN2.resize(n);
+	degSs.resize(n);
+	N2.reserve(n);
+	oHop.resize(n);
+	X.reserve(n);
+}
+
+void defclique::Context::preprocessing(Graph &G, Ordering &o, int u, int mode) {
 	S.clear();
 	C.clear();
 	C1.clear();
@@ -183,11 +232,13 @@ void defclique::preprocessing(Graph &G, Ordering &o, int u, int mode) {
 	S.push(u);
 
 	int i = o.order[u];
+	int lb = bound();
 
-	if (Ss.size() < k+1) {
+	if (lb < k+1) {
 		for (int j = i+1; j < o.numOrdered; ++j) {
 			int v = o.ordered[j];
 			C1.push(v);
+			degC1[v] = 0;
 		}
 	}
 
@@ -199,14 +250,15 @@ void defclique::preprocessing(Graph &G, Ordering &o, int u, int mode) {
 			if (o.order[v] > i) C1.push(v);
 	}
 	else {
-		for (int j = i+1; j < o.numOrdered; ++j) {
-			int v = o.ordered[j];
-			if (G.connect(u, v)) C1.push(v);
+		for (int j = i+1; j < o.numOrdered; j += 64) {
+			const int *w = &o.ordered[j];
+			for (uint64_t adj = G.connectMask(u, w, std::min(64, o.numOrdered-j)); adj; adj &= adj-1)
+				C1.push(w[__builtin_ctzll(adj)]);
 		}
 	}
 
-	if ((mode == ONE_HOP && Ss.size() >= C1.size()+1) || 
-		(mode == TWO_HOP && Ss.size() >= C1.size()+1+k)) {
+	if ((mode == ONE_HOP && lb >= C1.size()+1) || 
+		(mode == TWO_HOP && lb >= C1.size()+1+k)) {
 		S.clear();
 		C.clear();
 		C1.clear();
@@ -224,19 +276,22 @@ void defclique::preprocessing(Graph &G, Ordering &o, int u, int mode) {
 
 	for (int i = C1.frontPos(); i < C1.backPos(); ++i) {
 		int v = C1[i];
+		uint64_t adj = 0;
 		for (int j = i+1; j < C1.backPos(); ++j) {
-			int w = C1[j];
-			if (C1.backPos()-j+1 + Sub.nbr[v].size() < Ss.size()-k-1) break;
-			if (G.connect(v, w)) {
+			if (C1.backPos()-j+1 + Sub.nbr[v].size() < lb-k-1) break;
+			int b = (j-i-1) & 63;
+			if (b == 0) adj = G.connectMask(v, C1.begin() + (j-C1.frontPos()), std::min(64, C1.backPos()-j));
+			if (adj >> b & 1) {
+				int w = C1[j];
 				Sub.nbr[v].push_back(w);
 				Sub.nbr[w].push_back(v);
 				++Sub.m;
 			}
 		}
-		if (Sub.nbr[v].size()+k+1 < Ss.size()) {
+		if (Sub.nbr[v].size()+k+1 < lb) {
 			C1.pop(v);
 			q[tail++] = v;
-			if (mode == ONE_HOP && S.size()+C1.size() <= Ss.size()) {
+			if (mode == ONE_HOP && S.size()+C1.size() <= lb) {
 				S.clear();
 				C1.clear();
 				return;
@@ -249,7 +304,7 @@ void defclique::preprocessing(Graph &G, Ordering &o, int u, int mode) {
 		degC1[v] = Sub.nbr[v].size();
 
 	// for (int v : C1) {
-	// 	if (degC1[v] < Ss.size()-k-1) {
+	// 	if (degC1[v] < lb-k-1) {
 	// 		q[tail++] = v;
 	// 		sub(Sub, C1, degC1, v);
 	// 	}
@@ -261,20 +316,23 @@ void defclique::preprocessing(Graph &G, Ordering &o, int u, int mode) {
 		int v = q[head++];
 		if (Sub.nbr[v].size() < C1.size()) {
 			for (int w : Sub.nbr[v]) {
-				if (C1.inside(w) && degC1[w] < Ss.size()-k-1) {
+				if (C1.inside(w) && degC1[w] < lb-k-1) {
 					q[tail++] = w;
 					sub(Sub, C1, degC1, w);
 				}
 			}
 		}
 		else {
-			for (int w : C1)
-				if (Sub.connect(v, w) && degC1[w] < Ss.size()-k-1) {
-					q[tail++] = w;
-					sub(Sub, C1, degC1, w);
+			for (const int *x = C1.begin(), *end = C1.end(); x < end; x += 64)
+				for (uint64_t adj = G.connectMask(v, x, std::min(64, (int)(end-x))); adj; adj &= adj-1) {
+					int w = x[__builtin_ctzll(adj)];
+					if (degC1[w] < lb-k-1) {
+						q[tail++] = w;
+						sub(Sub, C1, degC1, w);
+					}
 				}
 		}
-		if (mode == ONE_HOP && S.size()+C1.size() <= Ss.size()) {
+		if (mode == ONE_HOP && S.size()+C1.size() <= lb) {
 			S.clear();
 			C1.clear();
 			return;
@@ -293,11 +351,14 @@ void defclique::preprocessing(Graph &G, Ordering &o, int u, int mode) {
 				}
 			}
 			else {
-				for (int j = i+1; j < o.numOrdered; ++j) {
-					int w = o.ordered[j];
-					if (G.connect(v, w) && !C1.inside(w)) {
-						degC1[w] = 0;
-						C.push(w);
+				for (int j = i+1; j < o.numOrdered; j += 64) {
+					const int *x = &o.ordered[j];
+					for (uint64_t adj = G.connectMask(v, x, std::min(64, o.numOrdered-j)); adj; adj &= adj-1) {
+						int w = x[__builtin_ctzll(adj)];
+						if (!C1.inside(w)) {
+							degC1[w] = 0;
+							C.push(w);
+						}
 					}
 				}
 			}
@@ -305,9 +366,9 @@ void defclique::preprocessing(Graph &G, Ordering &o, int u, int mode) {
 
 		for (int v : C1) {
 			if (C.size() < G.nbr[v].size()) {
-				for (int w : C)
-					if (G.connect(v, w))
-						++degC1[w];
+				for (const int *x = C.begin(); x < C.end(); x += 64)
+					for (uint64_t adj = G.connectMask(v, x, std::min(64, (int)(C.end()-x))); adj; adj &= adj-1)
+						++degC1[x[__builtin_ctzll(adj)]];
 			}
 			else {
 				for (int w : G.nbr[v])
@@ -317,7 +378,7 @@ void defclique::preprocessing(Graph &G, Ordering &o, int u, int mode) {
 		}
 
 		for (int v : C)
-			if (degC1[v] < Ss.size()-k)
+			if (degC1[v] < lb-k)
 				C.pop(v);
 	}
 
@@ -347,166 +408,399 @@ void defclique::preprocessing(Graph &G, Ordering &o, int u, int mode) {
 
 }
 
-VertexSet defclique::heuristic(Graph &G, int k) {
+template<typename Select>
+void defclique::Context::greedy(Graph &G, VertexSet &P, std::vector<int> &degP, Select select) {
 
-	log("Running heuristic algorithm...");
+	while (P.size() > 0 && S.size()+P.size() > Ss.size()) {
 
-	auto startTimePoint = std::chrono::steady_clock::now();
+		int u = select();
 
-	Ordering o, oSub;
+		// Add u from P to S
+		nnbS += S.size() - degS[u];
+		add(Sub, S, degS, u);
+		sub(Sub, P, degP, u);
 
-	o.degeneracyOrdering(G);
-
-	int maxCore = o.value[o.ordered[o.numOrdered-1]];
+		// Prune P
+		int head = 0, tail = 0;
+		for (int v : P) if (nnbS + S.size()-degS[v] > k || degP[v]+degS[v] < Ss.size()-k + nnbS) {
+			sub(Sub, P, degP, v);
+			q[tail++] = v;
+		}
 
-	Sub.resize(G.n);
+		while (head < tail) {
+			int v = q[head++];
+			if (Sub.nbr[v].size() < P.size()) {
+				for (int w : Sub.nbr[v]) if (degP[w]+degS[w] < Ss.size()-k + nnbS && P.inside(w)) {
+					sub(Sub, P, degP, w);
+					q[tail++] = w;
+				}
+			}
+			else {
+				for (int w : P) if (degP[w]+degS[w] < Ss.size()-k + nnbS && G.connect(v, w)) {
+					sub(Sub, P, degP, w);
+					q[tail++] = w;
+				}
+			}
+		}
 
-	for (int i = o.numOrdered-maxCore; i >= 0; --i) {
-		// fprintf(stderr, "%d/%d\r", o.numOrdered-i, o.numOrdered);
+		bool flagBreak = false;
 
-		int u = o.ordered[i];
-		if (o.value[u] < Ss.size()-k) break;
+		for (int v : S) if (degP[v] <= Ss.size()-k - S.size() + nnbS) {
+			P.clear();
+			flagBreak = true;
+			break;
+		}
 
-		preprocessing(G, o, u, ONE_HOP);
+		if (flagBreak) break;
 
-		oSub.degeneracyOrdering(Sub);
+	}
 
-		int j = oSub.numOrdered;	
+	if (Ss.size() < S.size()) {
+		Ss.clear();
+		for (int v : S) Ss.push(v);
+	}
+}
 
-		while (C.size() > 0 && S.size()+C.size() > Ss.size()) {
+void defclique::Context::heuristic(Graph &G, Ordering &o, Ordering &oSub, int u, int restarts) {
 
-			// Select a vertex from C with maximum degeneracy
-			int u = oSub.ordered[--j];
-			for (; !C.inside(u); u = oSub.ordered[--j]);
+	preprocessing(G, o, u, ONE_HOP);
 
+	oSub.degeneracyOrdering(Sub);
 
-			// Add u from C to S
-			nnbS += S.size() - degS[u];
-			add(Sub, S, degS, u);
-			sub(Sub, C, degC, u);
+	// Select a vertex from C with maximum degeneracy
+	int j = oSub.numOrdered;
+	greedy(G, C, degC, [&]() {
+		int v = oSub.ordered[--j];
+		for (; !C.inside(v); v = oSub.ordered[--j]);
+		return v;
+	});
 
-			// Prune C 
-			int head = 0, tail = 0;
-			for (int v : C) if (nnbS + S.size()-degS[v] > k || degC[v]+degS[v] < Ss.size()-k + nnbS) {
-				sub(Sub, C, degC, v);
-				q[tail++] = v;
+	S.clear();
+	S.push(u);
+	for (int v : Sub.V)
+		degS[v] = (int)G.connect(u, v);
+
+	// Select a vertex from C1 with maximum degree
+	greedy(G, C1, degC1, [&]() {
+		int v = C1[C1.frontPos()];
+		for (int w : C1) {
+			if (degS[w] + degC1[w] > degS[v] + degC1[v]) {
+				v = w;
 			}
+		}
+		return v;
+	});
 
-			while (head < tail) {
-				int v = q[head++];
-				if (Sub.nbr[v].size() < C.size()) {
-					for (int w : Sub.nbr[v]) if (degC[w]+degS[w] < Ss.size()-k + nnbS && C.inside(w)) {
-						sub(Sub, C, degC, w);
-						q[tail++] = w;
-					}
+	// Randomized restarts: same as above, but ties are broken uniformly at random
+	for (int r = 0; r < restarts; ++r) {
+		rng.seed(u * restarts + r);
+		preprocessing(G, o, u, ONE_HOP);
+		if (S.size() == 0) break;
+		greedy(G, C1, degC1, [&]() {
+			int v = C1[C1.frontPos()], cnt = 1;
+			for (int w : C1) {
+				if (w == v) continue;
+				if (degS[w] + degC1[w] > degS[v] + degC1[v]) {
+					v = w;
+					cnt = 1;
 				}
-				else {
-					for (int w : C) if (degC[w]+degS[w] < Ss.size()-k + nnbS && Sub.connect(v, w)) {
-						sub(Sub, C, degC, w);
-						q[tail++] = w;
-					}
+				else if (degS[w] + degC1[w] == degS[v] + degC1[v] && rng() % ++cnt == 0) {
+					v = w;
 				}
 			}
+			return v;
+		});
+	}
+}
 
-			bool flagBreak = false;
+VertexSet defclique::heuristic(Graph &G, int k, int threads, int restarts, Ordering *order) {
 
-			for (int v : S) if (degC[v] <= Ss.size()-k - S.size() + nnbS) {
-				C.clear();
-				flagBreak = true;
-				break;
-			}
+	TraceSpan span("heuristic");
 
-			if (flagBreak) break;
-			
-		}
+	log("Running heuristic algorithm with %d thread(s)...", threads);
 
-		if (Ss.size() < S.size()) {
-			Ss.clear();
-			for (int v : S) Ss.push(v);
-		}
+	auto startTimePoint = std::chrono::steady_clock::now();
 
-		S.clear(); 
-		S.push(u);
-		for (int v : Sub.V) 
-			degS[v] = (int)Sub.connect(u, v);
+	defclique::k = k;
 
-		while (C1.size() > 0 && S.size()+C1.size() > Ss.size()) {
+	Ordering local;
+	Ordering &o = order != nullptr ? *order : local;
 
-			// Select a vertex from C with maximum degree
-			int u = C1[C1.frontPos()];
-			for (int v : C1) {
-				if (degS[v] + degC1[v] > degS[u] + degC1[u]) {
-					u = v;
-				}
-			}
+	if (order == nullptr) o.degeneracyOrdering(G);
 
+	int maxCore = o.value[o.ordered[o.numOrdered-1]];
 
-			// Add u from C to S
-			nnbS += S.size() - degS[u];
-			add(Sub, S, degS, u);
-			sub(Sub, C1, degC1, u);
+	VertexSet best(G.n);
+	std::atomic<int> bestSize(0);
 
-			// Prune C 
-			int head = 0, tail = 0;
-			for (int v : C1) if (nnbS + S.size()-degS[v] > k || degC1[v]+degS[v] < Ss.size()-k + nnbS) {
-				sub(Sub, C1, degC1, v);
-				q[tail++] = v;
-			}
+	#pragma omp parallel num_threads(threads)
+	{
+		Context ctx;
+		Ordering oSub;
 
-			while (head < tail) {
-				int v = q[head++];
-				if (Sub.nbr[v].size() < C1.size()) {
-					for (int w : Sub.nbr[v]) if (degC1[w]+degS[w] < Ss.size()-k + nnbS && C1.inside(w)) {
-						sub(Sub, C1, degC1, w);
-						q[tail++] = w;
-					}
+		ctx.Sub.shareAdjacency(G);
+		ctx.reserve(G.n);
+
+		#pragma omp for schedule(dynamic, 1)
+		for (int i = o.numOrdered-maxCore; i >= 0; --i) {
+
+			if (timer.expired()) continue;
+
+			int u = o.ordered[i];
+
+			// Pick up the incumbent found by other threads
+			if (ctx.Ss.size() < bestSize) {
+				#pragma omp critical (heuristicBest)
+				{
+					ctx.Ss.clear();
+					for (int v : best) ctx.Ss.push(v);
 				}
-				else {
-					for (int w : C1) if (degC1[w]+degS[w] < Ss.size()-k + nnbS && Sub.connect(v, w)) {
-						sub(Sub, C1, degC1, w);
-						q[tail++] = w;
-					}
+			}
+
+			if (o.value[u] < ctx.Ss.size()-k) continue;
+
+			ctx.heuristic(G, o, oSub, u, restarts);
+
+			if (ctx.Ss.size() > bestSize) {
+				#pragma omp critical (heuristicBest)
+				if (ctx.Ss.size() > best.size()) {
+					best.clear();
+					for (int v : ctx.Ss) best.push(v);
+					bestSize = best.size();
+					logIncumbent(best, "heuristic");
 				}
 			}
+		}
+	}
 
-			bool flagBreak = false;
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds> (
+		std::chrono::steady_clock::now() - startTimePoint);
 
-			for (int v : S) if (degC1[v] <= Ss.size()-k - S.size() + nnbS) {
-				C1.clear();
-				flagBreak = true;
-				break;
+	log("Heuristic algorithm done! Time spent: %ld ms", duration.count());
+	logSet(best, "S*");
+
+	return best;
+
+}
+
+VertexSet defclique::localSearch(Graph &G, VertexSet &init, int k, long timeBudget) {
+
+	TraceSpan span("localSearch");
+
+	log("Running local search with time budget %ld ms...", timeBudget);
+
+	auto startTimePoint = std::chrono::steady_clock::now();
+
+	VertexSet S(G.n), Ss = init;
+	std::vector<int> degS(G.n), tabu(G.n);
+	std::mt19937 rng(G.n);
+	int nnbS = 0;
+	long long iter = 0, lastImprove = 0;
+
+	auto add = [&](int v) {
+		nnbS += S.size() - degS[v];
+		S.push(v);
+		for (int w : G.nbr[v]) ++degS[w];
+	};
+
+	auto remove = [&](int v) {
+		S.pop(v);
+		for (int w : G.nbr[v]) --degS[w];
+		nnbS -= S.size() - degS[v];
+	};
+
+	// A dropped vertex may not re-enter S for a few iterations
+	auto drop = [&](int v) {
+		remove(v);
+		tabu[v] = iter + 7 + rng() % 10;
+	};
+
+	// Vertices of S* outside the core cannot be part of a larger solution
+	for (int v : init)
+		if (G.V.inside(v)) add(v);
+
+	while (true) {
+
+		if ((++iter & 255) == 0 && (timer.expired() || std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - startTimePoint).count() >= timeBudget))
+			break;
+
+		// Restart from S* after a long run without improvement
+		if (iter - lastImprove > 4 * G.V.size()) {
+			while (S.size() > 0) remove(S[S.frontPos()]);
+			for (int v : Ss)
+				if (G.V.inside(v)) add(v);
+			if (S.size() > 0) drop(S[S.frontPos() + rng() % S.size()]);
+			lastImprove = iter;
+		}
+
+		// Add: a vertex outside S keeping at most k missing edges
+		int u = -1, v = -1, cnt = 0;
+		for (int w : G.V) {
+			if (S.inside(w) || tabu[w] > iter || nnbS + S.size() - degS[w] > k) continue;
+			if (v == -1 || degS[w] > degS[v]) { v = w; cnt = 1; }
+			else if (degS[w] == degS[v] && rng() % ++cnt == 0) v = w;
+		}
+
+		if (v != -1) {
+			add(v);
+			if (S.size() > Ss.size()) {
+				Ss = S;
+				lastImprove = iter;
+				logIncumbent(Ss, "local search");
 			}
+			continue;
+		}
 
-			if (flagBreak) break;
-			
+		// Swap: replacing u by v gives nnbS + degS[u] - degS[v] + [u~v] missing edges
+		int minDeg = S.size();
+		for (int x : S) minDeg = std::min(minDeg, degS[x]);
+
+		int best = k+1;
+		for (int w : G.V) {
+			if (S.inside(w) || tabu[w] > iter || nnbS + minDeg - degS[w] > k) continue;
+			for (int x : S) {
+				int val = nnbS + degS[x] - degS[w] + (int)G.connect(x, w);
+				if (val > k) continue;
+				if (val < best) { u = x; v = w; best = val; cnt = 1; }
+				else if (val == best && rng() % ++cnt == 0) { u = x; v = w; }
+			}
 		}
 
+		if (v != -1) {
+			drop(u);
+			add(v);
+			continue;
+		}
 
-		if (Ss.size() < S.size()) {
-			Ss.clear();
-			for (int v : S) Ss.push(v);
+		// Drop: the vertex of S with the most missing edges
+		for (int x : S) {
+			if (u == -1 || degS[x] < degS[u]) { u = x; cnt = 1; }
+			else if (degS[x] == degS[u] && rng() % ++cnt == 0) u = x;
 		}
-	}
 
+		if (u == -1) break;
+		drop(u);
+	}
 
 	auto duration = std::chrono::duration_cast<std::chrono::milliseconds> (
 		std::chrono::steady_clock::now() - startTimePoint);
 
-	log("Heuristic algorithm done! Time spent: %ld ms", duration.count());
+	log("Local search done! Iterations: %lld, Time spent: %ld ms", iter, duration.count());
 	logSet(Ss, "S*");
 
 	return Ss;
-	
 }
 
+static long millisecondsSince(std::chrono::steady_clock::time_point t) {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - t).count();
+}
+
+static std::string formatMicroseconds(long long us) {
+	char buf[32];
+	if (us < 1000) snprintf(buf, sizeof(buf), "%lld us", us);
+	else if (us < 1000000) snprintf(buf, sizeof(buf), "%lld ms", us / 1000);
+	else snprintf(buf, sizeof(buf), "%lld s", us / 1000000);
+	return buf;
+}
+
+// Logs a histogram of the cost of the roots, in powers of two of their time,
+// and writes the most expensive ones to a CSV file
+static void reportRootCosts(std::vector<defclique::RootCost> &costs, const std::string &filename, int top) {
+	auto total = [](const defclique::RootCost &c) { return c.preprocessTime + c.branchTime; };
+
+	std::sort(costs.begin(), costs.end(), [&](const defclique::RootCost &a, const defclique::RootCost &b) {
+		return total(a) > total(b);
+	});
+
+	long long sum = 0;
+	std::vector<int> count;
+	std::vector<long long> time;
+	for (auto &c : costs) {
+		int b = 0;
+		while ((2ll << b) <= total(c)) ++b;
+		if (b >= count.size()) {
+			count.resize(b+1, 0);
+			time.resize(b+1, 0);
+		}
+		++count[b];
+		time[b] += total(c);
+		sum += total(c);
+	}
+
+	auto share = [&](size_t n) {
+		long long t = 0;
+		for (size_t i = 0; i < n && i < costs.size(); ++i) t += total(costs[i]);
+		return sum > 0 ? 100.0 * t / sum : 0.0;
+	};
+
+	log("Root costs: %d roots, %s in total; the top 1%% take %.1f%%, the top 10 take %.1f%%",
+		(int)costs.size(), formatMicroseconds(sum).c_str(), share((costs.size() + 99) / 100), share(10));
+	for (int b = 0; b < count.size(); ++b) {
+		if (count[b] == 0) continue;
+		log("  [%8s, %8s): %8d roots, %5.1f%% of the time",
+			b == 0 ? "0 us" : formatMicroseconds(1ll << b).c_str(), formatMicroseconds(2ll << b).c_str(),
+			count[b], sum > 0 ? 100.0 * time[b] / sum : 0.0);
+	}
+
+	FILE *fp = fopen(filename.c_str(), "w");
+	if (fp == nullptr) {
+		log("Warning: unable to write root costs %s", filename.c_str());
+		return;
+	}
+	fprintf(fp, "root,preprocess_us,branch_us,total_us,candidates,colors,nodes\n");
+	for (int i = 0; i < top && i < costs.size(); ++i) {
+		auto &c = costs[i];
+		fprintf(fp, "%d,%lld,%lld,%lld,%d,%d,%lld\n", c.root, c.preprocessTime, c.branchTime,
+			total(c), c.candidates, c.colors, c.numNodes);
+	}
+	fclose(fp);
+
+	log("The %d most expensive roots written to %s", std::min(top, (int)costs.size()), filename.c_str());
+}
+
+static std::string megabytes(size_t bytes) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.1f MB", bytes / 1048576.0);
+	return buf;
+}
 
-void defclique::run(const std::string &filename, int k, int mode) {
+static std::string graphMemory(const char *name, const Graph &G) {
+	return std::string(name) + "=" + megabytes(G.memory()) + " (nbr " + megabytes(G.nbrMemory()) +
+		", nbrMap " + megabytes(G.nbrMapMemory()) + ")";
+}
+
+static std::string contextMemory(const defclique::Context &ctx) {
+	size_t sets = 0, arrays = 0;
+	for (auto *V : {&ctx.S, &ctx.C, &ctx.Ss, &ctx.C1, &ctx.D, &ctx.N2, &ctx.X}) sets += V->memory();
+	for (auto *a : {&ctx.degC1, &ctx.degC, &ctx.degS, &ctx.cnD, &ctx.q, &ctx.degN2, &ctx.degSs})
+		arrays += a->capacity() * sizeof(int);
+	return graphMemory("Sub", ctx.Sub) + ", sets=" + megabytes(sets) + ", arrays=" + megabytes(arrays) +
+		", coloring=" + megabytes(ctx.clr.memory()) + ", orderings=" + megabytes(ctx.oHop.memory() + ctx.oSub.memory());
+}
+
+static void logMemory(const char *phase, const std::string &items) {
+	log("Memory after %s: %s; RSS=%.1f MB, peak RSS=%.1f MB", phase, items.c_str(),
+		defclique::currentMemory() / 1024.0, defclique::peakMemory() / 1024.0);
+}
+
+static void logCounters(const char *phase, const PerfSample &counters) {
+	if (perfCounters().active())
+		log("%s counters: %s", phase, counters.toString().c_str());
+}
+
+static Graph readGraph(const std::string &filename, int threads, PerfSample *counters = nullptr) {
+
+	TraceSpan span("load");
+	PerfSample local;
+	PerfScope perf(counters != nullptr ? *counters : local);
 
 	log("Reading graph: %s ...", strrchr(filename.c_str(), '/')+1);
 
 	auto startTimePoint = std::chrono::steady_clock::now();
 
-	Graph G(filename);
+	Graph G(filename, threads);
 
 	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
 		std::chrono::steady_clock::now() - startTimePoint);
@@ -514,85 +808,480 @@ void defclique::run(const std::string &filename, int k, int mode) {
 	log("Reading graph done! Time spent: %ld ms", duration.count());
 	log("Graph info: n=%d, m=%d, maxdeg=%d", G.V.size(), G.m, G.maxDeg);
 
+	return G;
+}
+
+// Greedily add the vertices keeping Ss a k-defective clique. degS is a
+// zeroed scratch array over the vertices of G and is left zeroed.
+void defclique::extend(Graph &G, VertexSet &Ss, int k, std::vector<int> &degS) {
+	int nnbS = 0;
+	for (int v : Ss)
+		for (int w : G.nbr[v]) ++degS[w];
+	for (int v : Ss) nnbS += Ss.size() - 1 - degS[v];
+	nnbS /= 2;
+
+	for (bool flag = true; flag; ) {
+		flag = false;
+		for (int v : Ss)
+			for (int w : G.nbr[v])
+				if (!Ss.inside(w) && nnbS + Ss.size() - degS[w] <= k) {
+					nnbS += Ss.size() - degS[w];
+					Ss.push(w);
+					for (int x : G.nbr[w]) ++degS[x];
+					flag = true;
+					break;
+				}
+	}
+
+	for (int v : Ss)
+		for (int w : G.nbr[v]) degS[w] = 0;
+}
+
+defclique::Result defclique::run(const std::string &filename, int k, int mode, const Options &opt) {
+
+	timer.start(opt.timeLimit);
+
+	auto startTimePoint = std::chrono::steady_clock::now();
+	PerfSample loadCounters;
+	Graph G = readGraph(filename, opt.threads, &loadCounters);
+	long loadTime = millisecondsSince(startTimePoint);
+	logCounters("Load", loadCounters);
+
+	if (opt.memoryStats) logMemory("load", graphMemory("G", G));
+
+	Result res = opt.vertex >= 0 ? solveVertex(G, k, opt.vertex) : solve(G, k, mode, opt);
+	res.n = G.V.size();
+	res.m = G.m;
+	res.maxDeg = G.maxDeg;
+	res.stats.loadTime = loadTime;
+	res.stats.loadCounters = loadCounters;
+
+	return res;
+}
+
+std::vector<defclique::Result> defclique::sweep(const std::string &filename, int maxK, int mode, const Options &opt) {
+
+	timer.start(opt.timeLimit);
+
+	auto startTimePoint = std::chrono::steady_clock::now();
+	PerfSample loadCounters;
+	Graph G = readGraph(filename, opt.threads, &loadCounters);
+	long loadTime = millisecondsSince(startTimePoint);
+	logCounters("Load", loadCounters);
+
+	if (opt.memoryStats) logMemory("load", graphMemory("G", G));
+
+	std::vector<Result> res;
+	std::vector<int> degS(G.n);
+	Cache state;
+
+	for (int k = 0; k <= maxK; ++k) {
+
+		log("********** Sweep: k=%d **********", k);
+
+		TraceSpan span("sweep", "phase", "k", k);
+		auto sweepStartTimePoint = std::chrono::steady_clock::now();
+
+		// S* of k-1 is a k-defective clique; greedily extend it with
+		// vertices missing at most one more edge
+		if (k > 0) extend(G, state.Ss, k, degS);
 
-	S.reserve(G.n);
-	C.reserve(G.n);
-	C1.reserve(G.n);
-	D.reserve(G.n);
-	Ss.reserve(G.n);
+		// Each k writes its own root costs, to <file>.k<k>
+		Options o = opt;
+		if (!opt.rootCosts.empty()) o.rootCosts = opt.rootCosts + ".k" + std::to_string(k);
 
-	degS.resize(G.n);
-	degC.resize(G.n);
-	degC1.resize(G.n);
-	cnD.resize(G.n);
-	q.resize(G.n);
+		res.push_back(opt.vertex >= 0 ? solveVertex(G, k, opt.vertex) : solve(G, k, mode, o, &state));
+		state.Ss = res.back().Ss;
+		res.back().n = G.V.size();
+		res.back().m = G.m;
+		res.back().maxDeg = G.maxDeg;
+		res.back().stats.loadTime = k == 0 ? loadTime : 0;
+		if (k == 0) res.back().stats.loadCounters = loadCounters;
+		res.back().stats.sweepTime = millisecondsSince(sweepStartTimePoint) + res.back().stats.loadTime;
 
-	Sub.nbrMap = G.nbrMap;
+		log("Sweep result: k=%d, size=%d, optimal=%s", k, res.back().Ss.size(), 
+			res.back().optimal ? "yes" : "no");
+
+		if (timer.stopped()) break;
+	}
+
+	return res;
+}
+
+std::vector<int> defclique::profile(const std::string &filename, int k, const std::string &output, const Options &opt) {
+
+	timer.start(opt.timeLimit);
+
+	Graph G = readGraph(filename, opt.threads);
+
+	std::vector<int> res = profile(G, k, opt.threads);
+
+	// CSV for a .csv file, otherwise a raw array of n 32-bit integers
+	bool csv = output.size() >= 4 && output.compare(output.size()-4, 4, ".csv") == 0;
+	FILE *fp = fopen(output.c_str(), csv ? "w" : "wb");
+
+	if (fp == nullptr) {
+		log("Warning: unable to write profile %s", output.c_str());
+		return res;
+	}
+
+	if (csv) {
+		fprintf(fp, "vertex,size\n");
+		for (int v = 0; v < res.size(); ++v)
+			fprintf(fp, "%d,%d\n", v, res[v]);
+	}
+	else {
+		std::vector<int32_t> buf(res.begin(), res.end());
+		fwrite(buf.data(), sizeof(int32_t), buf.size(), fp);
+	}
+
+	fclose(fp);
+
+	log("Profile written to %s", output.c_str());
+
+	return res;
+}
+
+std::vector<defclique::Result> defclique::top(const std::string &filename, int k, int n, const Options &opt) {
+
+	timer.start(opt.timeLimit);
+
+	Graph G = readGraph(filename, opt.threads);
+
+	return top(G, k, n, opt.threads);
+}
+
+long long defclique::enumerate(const std::string &filename, int k, int minSize, const std::string &output, const Options &opt) {
+
+	timer.start(opt.timeLimit);
+
+	Graph G = readGraph(filename, opt.threads);
+
+	FILE *fp = fopen(output.c_str(), "w");
+
+	if (fp == nullptr) {
+		log("Warning: unable to write solutions to %s", output.c_str());
+		return 0;
+	}
+
+	long long res = enumerate(G, k, minSize, fp, opt.threads);
+
+	fclose(fp);
+
+	log("Solutions written to %s", output.c_str());
+
+	return res;
+}
+
+// Whether the S* of a checkpoint holds distinct vertices of G forming a
+// k-defective clique, and the core was not reduced beyond its size
+static bool validCheckpoint(Graph &G, const defclique::Checkpoint &cp, int k) {
+	VertexSet S(G.n);
+	for (int v : cp.Ss) {
+		if (v < 0 || v >= G.n || !G.V.inside(v) || S.inside(v)) return false;
+		S.push(v);
+	}
+	return cp.coreBound <= S.size() && defclique::missingEdges(G, S) <= k;
+}
+
+defclique::Result defclique::solve(Graph &G, int k, int mode, const Options &opt, Cache *cache) {
+
+	TraceSpan span("solve", "phase", "k", k);
+
+	Context ctx;
+
+	ctx.Sub.shareAdjacency(G);
+	ctx.reserve(G.n);
 
 	defclique::k = k;
 	defclique::mode = mode;
 
-	Ss = heuristic(G, k);
+	Checkpoint cp;
+	bool resumed = false;
+
+	if (!opt.checkpoint.empty()) {
+		cp.fingerprint = G.fingerprint();
+		cp.k = k;
+		cp.mode = mode;
+	}
+
+	if (opt.resume) {
+		Checkpoint saved;
+		if (!saved.load(opt.checkpoint, G.n))
+			log("Warning: unable to read checkpoint %s, starting from scratch.", opt.checkpoint.c_str())
+		else if (saved.fingerprint != cp.fingerprint || saved.k != k || saved.mode != mode)
+			log("Warning: checkpoint %s does not match this run, starting from scratch.", opt.checkpoint.c_str())
+		else if (!validCheckpoint(G, saved, k))
+			log("Warning: checkpoint %s holds an invalid S*, starting from scratch.", opt.checkpoint.c_str())
+		else {
+			resumed = true;
+			cp = saved;
+			for (int v : cp.Ss) ctx.Ss.push(v);
+			log("Resuming from checkpoint: next root=%d", cp.next);
+			logSet(ctx.Ss, "S*");
+		}
+	}
+
+	Cache local;
+	Cache &state = cache != nullptr ? *cache : local;
+
+	Stats stats;
+	auto heuristicStartTimePoint = std::chrono::steady_clock::now();
+	PerfSample heuristicStart = perfCounters().read();
+
+	if (state.Ss.size() > 0 && !resumed) {
+		ctx.Ss = state.Ss;
+		logSet(ctx.Ss, "S*");
+	}
+	else if (!resumed) {
+		if (cache != nullptr && !state.orderedG) {
+			state.oG.degeneracyOrdering(G);
+			state.orderedG = true;
+		}
+		ctx.Ss = heuristic(G, k, opt.threads, opt.restarts, cache != nullptr ? &state.oG : nullptr);
+	}
+	stats.heuristicTime = millisecondsSince(heuristicStartTimePoint);
+	stats.heuristicCounters.add(heuristicStart, perfCounters().read());
+
+	if (opt.memoryStats) logMemory("heuristic", graphMemory("G", G) + ", " + contextMemory(ctx));
 /*
-	if (Ss.size() < k+1) {
+	if (ctx.Ss.size() < k+1) {
 		for (int v : G.V) {
-			Ss.push(v);
-			if (Ss.size() == k+1) break;
+			ctx.Ss.push(v);
+			if (ctx.Ss.size() == k+1) break;
 		}
 	}
 */
 
-	Graph Core = G;
+	Ordering &o = state.o;
 
-	if (Ss.size() >= k+1) {	
-		Core = coreReduction(Core, Ss.size() - k);
+	// The core is always reduced from G, so that a resumed run sees the same
+	// root ordering. A cache keeps the core while the threshold stays the same.
+	// A threshold of at most 1 removes nothing, and G is searched as it is
+	// rather than through a copy.
+	auto core = [&]() -> Graph & { return state.threshold > 1 ? state.Core : G; };
+
+	auto reduce = [&](int bound) {
+		int threshold = bound >= k+1 && !timer.expired() ? bound - k : 0;
+		if (threshold == state.threshold) {
+			log("Reusing core: n=%d, m=%d", core().V.size(), core().m);
+			return;
+		}
+		auto reductionStartTimePoint = std::chrono::steady_clock::now();
+		PerfScope perf(stats.reductionCounters);
+		if (threshold > 1) {
+			state.Core = coreReduction(G, threshold);
 #ifdef EDGE_REDUCTION
-		Core = edgeReduction(Core, Ss.size() - k - 1);
+			state.Core = edgeReduction(state.Core, threshold - 1);
 #endif
+		}
+		else state.Core.clear();
+		stats.reductionTime += millisecondsSince(reductionStartTimePoint);
+		state.threshold = threshold;
+		state.ordered = state.relabelled = false;
+	};
+
+	if (!resumed) cp.coreBound = ctx.Ss.size();
+
+	reduce(cp.coreBound);
+
+	if (opt.lsTime > 0 && !resumed && cp.coreBound >= k+1 && !timer.expired()) {
+		auto lsStartTimePoint = std::chrono::steady_clock::now();
+		PerfSample lsStart = perfCounters().read();
+		ctx.Ss = localSearch(core(), ctx.Ss, k, opt.lsTime);
+		stats.heuristicTime += millisecondsSince(lsStartTimePoint);
+		stats.heuristicCounters.add(lsStart, perfCounters().read());
+		if (ctx.Ss.size() > cp.coreBound) {
+			cp.coreBound = ctx.Ss.size();
+			reduce(cp.coreBound);
+		}
 	}
 
-	log("Running core ordering...");
+	Graph &Core = core();
 
-	startTimePoint = std::chrono::steady_clock::now();
+	if (opt.memoryStats) logMemory("reduction", graphMemory("Core", Core));
 
-	Ordering o = Ordering::DegeneracyOrdering(Core);
+	if (!state.ordered) {
+		log("Running core ordering...");
 
-	duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-		std::chrono::steady_clock::now() - startTimePoint);
+		TraceSpan span("ordering");
+		PerfScope perf(stats.orderingCounters);
+
+		auto startTimePoint = std::chrono::steady_clock::now();
+
+		o.degeneracyOrdering(Core);
+		state.ordered = true;
+
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - startTimePoint);
+		stats.orderingTime = duration.count();
+
+		log("Core ordering done! Max core: %d, Time spent: %ld ms", 
+			o.numOrdered > 0 ? o.value[o.ordered[o.numOrdered-1]] : 0, duration.count()); 
+	}
+
+	if (opt.memoryStats) logMemory("ordering", "ordering=" + megabytes(o.memory()));
+
+	// The root index of a checkpoint can only be checked against the ordering
+	// of the core, built from it; an invalid one is dropped as above
+	if (resumed && (mode == REDUCTION_SEARCH ? cp.next < 0 || cp.next > o.numOrdered
+			: cp.next < -1 || cp.next >= o.numOrdered)) {
+		log("Warning: checkpoint %s holds an invalid root index, starting from scratch.", opt.checkpoint.c_str());
+		Options fresh = opt;
+		fresh.resume = false;
+		return solve(G, k, mode, fresh, cache);
+	}
 
-	log("Core ordering done! Max core: %d, Time spent: %ld ms", o.value[o.ordered[o.numOrdered-1]], duration.count()); 
+	// With relabel, the roots are searched in a copy of the core where every
+	// vertex is renamed to its position in the ordering, the other vertices
+	// of G following in increasing order. A root and the later vertices its
+	// sub-problem is built from then have close ids, and their lists and
+	// hash tables lie close in memory. S* is kept in the new ids during the
+	// search, and mapped back for the log, the checkpoints and the result.
+	if (opt.relabel && !state.relabelled) {
+		log("Running relabelling...");
+
+		TraceSpan span("relabelling");
+		PerfScope perf(stats.orderingCounters);
+
+		auto startTimePoint = std::chrono::steady_clock::now();
+
+		state.label.resize(G.n);
+		state.id.assign(G.n, -1);
+		int next = 0;
+		for (int i = 0; i < o.numOrdered; ++i) state.id[o.ordered[i]] = next++;
+		for (int v = 0; v < G.n; ++v)
+			if (state.id[v] == -1) state.id[v] = next++;
+		for (int v = 0; v < G.n; ++v) state.label[state.id[v]] = v;
+
+		state.Relabelled.relabel(Core, state.id, opt.threads);
+		state.oRelabelled.resize(G.n);
+		state.oRelabelled.numOrdered = 0;
+		for (int i = 0; i < o.numOrdered; ++i)
+			state.oRelabelled.push(i, o.value[o.ordered[i]]);
+		state.relabelled = true;
+
+		long duration = millisecondsSince(startTimePoint);
+		stats.orderingTime += duration;
+
+		log("Relabelling done! Time spent: %ld ms", duration);
+
+		if (opt.memoryStats) logMemory("relabelling", graphMemory("Relabelled", state.Relabelled));
+	}
+
+	Graph &Search = opt.relabel ? state.Relabelled : Core;
+	Ordering &order = opt.relabel ? state.oRelabelled : o;
+
+	if (opt.relabel) {
+		ctx.Sub.shareAdjacency(Search);
+		ctx.label = &state.label;
+		VertexSet Ss(G.n);
+		for (int v : ctx.Ss) Ss.push(state.id[v]);
+		ctx.Ss = Ss;
+	}
 
 	std::string modeString = mode == REDUCTION_SEARCH ? "Reduction" : "Russian Doll";
 	log("Running %s search ...", modeString.c_str());
 
-	startTimePoint = std::chrono::steady_clock::now();
+	TraceSpan searchSpan("search");
+	auto startTimePoint = std::chrono::steady_clock::now();
 
 	long long branchTimeCount = 0, preTimeCount = 0;
+	std::vector<RootCost> rootCosts;
+	long lastCheckpoint = timer.elapsed();
+
+	auto saveCheckpoint = [&](int next) {
+		cp.next = next;
+		if (ctx.label != nullptr) {
+			VertexSet original = originalIds(ctx.Ss, *ctx.label);
+			cp.Ss.assign(original.begin(), original.end());
+		}
+		else cp.Ss.assign(ctx.Ss.begin(), ctx.Ss.end());
+		if (!cp.save(opt.checkpoint))
+			log("Warning: unable to write checkpoint %s", opt.checkpoint.c_str());
+		lastCheckpoint = timer.elapsed();
+	};
 
-	for (int i = mode == REDUCTION_SEARCH ? 0 : o.numOrdered - 1; 
-		i >= 0 && i < o.numOrdered; mode == REDUCTION_SEARCH ? ++i : --i) {
+	int i = mode == REDUCTION_SEARCH ? 0 : order.numOrdered - 1;
+	if (resumed) i = cp.next;
+
+	// Roots are assumed to cost (forward degree + 1)^2 to extrapolate the
+	// remaining time, over the roots the current S* does not already cut
+	auto weight = [&](int u) { return (order.value[u] + 1.0) * (order.value[u] + 1.0); };
+	double totalWeight = 0, doneWeight = 0;
+	int numRoots = 0, numRootsDone = 0;
+	for (int j = i; j >= 0 && j < order.numOrdered; mode == REDUCTION_SEARCH ? ++j : --j) {
+		if (mode == RUSSIANDOLL_SEARCH && order.value[order.ordered[j]] < ctx.Ss.size()-k) break;
+		if (mode == REDUCTION_SEARCH && order.numOrdered-j <= ctx.Ss.size()) break;
+		totalWeight += weight(order.ordered[j]);
+		++numRoots;
+	}
+	progress().start(modeString, numRoots);
 
-		int u = o.ordered[i];
+	for (; i >= 0 && i < order.numOrdered; mode == REDUCTION_SEARCH ? ++i : --i) {
+
+		if (!opt.checkpoint.empty() && timer.elapsed() - lastCheckpoint >= opt.checkpointInterval)
+			saveCheckpoint(i);
+
+		int u = order.ordered[i];
+		int root = opt.relabel ? state.label[u] : u;	// in the log, the trace and the costs
 
 #ifdef DEBUG_BRANCH
-		log("********** New branch: u=%d **********\n", u);
+		log("********** New branch: u=%d **********\n", root);
 #endif
 
-		if (mode == RUSSIANDOLL_SEARCH && o.value[u] < Ss.size()-k) break;
-		if (mode == REDUCTION_SEARCH && o.numOrdered-i <= Ss.size()) break;
+		if (timer.expired()) break;
+		if (mode == RUSSIANDOLL_SEARCH && order.value[u] < ctx.Ss.size()-k) break;
+		if (mode == REDUCTION_SEARCH && order.numOrdered-i <= ctx.Ss.size()) break;
 
+		progress().root(numRootsDone++, ctx.Ss.size(), totalWeight > 0 ? doneWeight / totalWeight : 0);
+		doneWeight += weight(u);
+
+		TraceSpan rootSpan("root", "root", "u", root, opt.traceRoots);
 		
 		auto preStartTimePoint = std::chrono::steady_clock::now();
-		preprocessing(Core, o, u, TWO_HOP);
-		preTimeCount += std::chrono::duration_cast<std::chrono::microseconds>(
+		PerfSample preStart = perfCounters().read();
+		ctx.preprocessing(Search, order, u, TWO_HOP);
+		long long preTime = std::chrono::duration_cast<std::chrono::microseconds>(
 			std::chrono::steady_clock::now() - preStartTimePoint).count();
-		if (C.size()+S.size() <= Ss.size()) continue;
-		clr.graphColoring(Sub, Ss.size()-k+1);
+		preTimeCount += preTime;
+		stats.preprocessCounters.add(preStart, perfCounters().read());
+		RootCost cost{root, preTime, 0, ctx.C.size(), 0, 0};
+		if (ctx.C.size()+ctx.S.size() <= ctx.Ss.size()) {
+			if (!opt.rootCosts.empty()) rootCosts.push_back(cost);
+			continue;
+		}
+		ctx.clr.graphColoring(ctx.Sub, ctx.Ss.size()-k+1);
 		auto branchStartTimePoint = std::chrono::steady_clock::now();
-		branch(0);
-		branchTimeCount += std::chrono::duration_cast<std::chrono::microseconds>(
+		long long rootNodes = ctx.numNodes;
+		PerfSample branchStart = perfCounters().read();
+		ctx.branch(0);
+		stats.branchCounters.add(branchStart, perfCounters().read());
+		cost.branchTime = std::chrono::duration_cast<std::chrono::microseconds>(
 			std::chrono::steady_clock::now() - branchStartTimePoint).count();
+		branchTimeCount += cost.branchTime;
+		cost.colors = ctx.clr.numColors;
+		cost.numNodes = ctx.numNodes - rootNodes;
+		if (!opt.rootCosts.empty()) rootCosts.push_back(cost);
+		if (opt.branchStats)
+			log("Root %d: nodes=%lld, %s", root, ctx.numNodes - rootNodes, ctx.branchStats.toString().c_str());
+		stats.branch.add(ctx.branchStats);
+		ctx.branchStats = BranchStats();
+		if (timer.stopped()) break;
 	}
+
+	progress().stop();
+
+	if (opt.relabel) {
+		ctx.Ss = originalIds(ctx.Ss, state.label);
+		ctx.label = nullptr;
+		ctx.Sub.shareAdjacency(G);
+	}
+
+	if (opt.memoryStats) logMemory("search", contextMemory(ctx));
+
+	if (!opt.checkpoint.empty())
+		saveCheckpoint(i);
 	
 
 	auto totalTimeCount = std::chrono::duration_cast<std::chrono::milliseconds> (
@@ -602,21 +1291,43 @@ void defclique::run(const std::string &filename, int k, int mode) {
 	log("%s search done! Preprocess time: %ld ms, branch time: %ld ms, total time: %ld ms", 
 		modeString.c_str(), preTimeCount/1000l, branchTimeCount/1000l, (long)totalTimeCount);
 
-	if (Ss.size() < k+2) {
-		//Ss.clear();
+	if (!opt.rootCosts.empty())
+		reportRootCosts(rootCosts, opt.rootCosts, opt.rootCostsTop);
+
+	if (ctx.Ss.size() < k+2) {
+		//ctx.Ss.clear();
 		log("Warning: unable to find a defective clique with size larger than k+2.")		
 	}
 
-	logSet(Ss, "S*");
+	stats.preprocessTime = preTimeCount/1000l;
+	stats.branchTime = branchTimeCount/1000l;
+	stats.numNodes = ctx.numNodes;
+
+	log("Branch statistics (fired/children): nodes=%lld, %s", stats.numNodes, stats.branch.toString().c_str());
+
+	logCounters("Heuristic", stats.heuristicCounters);
+	logCounters("Reduction", stats.reductionCounters);
+	logCounters("Ordering", stats.orderingCounters);
+	logCounters("Preprocess", stats.preprocessCounters);
+	logCounters("Branch", stats.branchCounters);
+
+	Result res;
+	res.optimal = !timer.stopped();
+	res.stats = stats;
+
+	if (!res.optimal)
+		log("Time limit of %ld ms reached, optimality not proven.", opt.timeLimit);
+
+	logSet(ctx.Ss, "S*");
 
 #ifdef DEBUG_RESULT
 
-	Sub.subGraph(G, Ss);
+	ctx.Sub.subGraph(G, ctx.Ss);
 
 	int cnt = 0;
-	for (int v : Sub.V) {
-		for (int w : Sub.V)
-			if (v < w && !Sub.connect(v, w)) {
+	for (int v : ctx.Sub.V) {
+		for (int w : ctx.Sub.V)
+			if (v < w && !ctx.Sub.connect(v, w)) {
 				log("Missing edge in S*: (%d, %d)", v, w);
 				++cnt;
 			}
@@ -624,10 +1335,371 @@ void defclique::run(const std::string &filename, int k, int mode) {
 	log("Number of missing edges in S*: %d", cnt);
 #endif
 
+	res.Ss = ctx.Ss;
+	res.missingEdges = missingEdges(G, res.Ss);
+	return res;
+}
+
+// A defective clique with more than k+1 vertices has diameter at most 2, so
+// the largest one containing the target lies in its two-hop neighbourhood,
+// searched as a single sub-problem rooted at the target. core holds the
+// core numbers of G, and S* must be empty or contain the target.
+void defclique::Context::searchVertex(Graph &G, std::vector<int> &core, int target) {
+
+	// The target comes first, and the vertices left out of N2 must not be
+	// ordered after it
+	auto orderN2 = [&]() {
+		for (int i = 0; i < oHop.numOrdered; ++i)
+			oHop.order[oHop.ordered[i]] = 0;
+		oHop.numOrdered = 0;
+		oHop.push(target, 0);
+		for (int v : N2)
+			if (v != target) oHop.push(v, 0);
+	};
+
+	// Initial S*: the greedy solution rooted at the target among its
+	// neighbours, rerun while it improves since a larger S* prunes more
+	N2.clear();
+	for (int v : G.nbr[target]) N2.push(v);
+	orderN2();
+
+	for (int size = -1; size < Ss.size(); ) {
+		size = Ss.size();
+		heuristic(G, oHop, oSub, target);
+	}
+	extend(G, Ss, k, degSs);
+	if (!quiet) logIncumbent(Ss, "heuristic");
+
+	// Vertices of a larger solution are in the (|S*|-k)-core of the
+	// neighbourhood, and so are the middle vertices of its two-hop paths
+	int threshold = Ss.size() - k;
+	if (core[target] < threshold) return;
+
+	N2.clear();
+	N2.push(target);
+	for (int v : G.nbr[target])
+		if (core[v] >= threshold) N2.push(v);
+	for (int i = N2.frontPos()+1, end = N2.backPos(); i < end; ++i)
+		for (int w : G.nbr[N2[i]])
+			if (core[w] >= threshold) N2.push(w);
+
+	// Besides, a vertex shares with the target all but at most k of the
+	// other vertices, one less if they are not adjacent
+	int head = 0, tail = 0;
+	for (int v : N2) {
+		int cn = G.connect(target, v);
+		degN2[v] = 0;
+		for (int w : G.nbr[v])
+			if (N2.inside(w)) {
+				++degN2[v];
+				if (G.connect(target, w)) ++cn;
+			}
+		if (degN2[v] < threshold || (v != target && cn < threshold)) q[tail++] = v;
+	}
+	for (int i = 0; i < tail; ++i) N2.pop(q[i]);
+	while (head < tail) {
+		int v = q[head++];
+		for (int w : G.nbr[v])
+			if (N2.inside(w) && --degN2[w] < threshold) {
+				N2.pop(w);
+				q[tail++] = w;
+			}
+	}
+
+	if (!N2.inside(target) || timer.expired()) return;
+
+	orderN2();
+
+	preprocessing(G, oHop, target, TWO_HOP);
+	if (C.size()+S.size() > Ss.size()) {
+		clr.graphColoring(Sub, Ss.size()-k+1);
+		branch(0);
+	}
+}
+
+static std::vector<int> coreNumbers(Ordering &o) {
+	std::vector<int> core(o.order.size());
+	for (int i = 0, c = 0; i < o.numOrdered; ++i) {
+		int v = o.ordered[i];
+		core[v] = c = std::max(c, o.value[v]);
+	}
+	return core;
+}
+
+defclique::Result defclique::solveVertex(Graph &G, int k, int q, Ordering *order) {
+
+	TraceSpan span("vertexQuery", "phase", "q", q);
+
+	log("Running vertex query with q=%d ...", q);
+
+	auto startTimePoint = std::chrono::steady_clock::now();
+
+	defclique::k = k;
+	defclique::mode = REDUCTION_SEARCH;
+
+	Result res;
+	res.optimal = true;
+
+	if (q < 0 || q >= G.n || !G.V.inside(q)) {
+		log("Warning: vertex %d is not in the graph.", q);
+		return res;
+	}
+
+	Ordering local;
+	Ordering &o = order != nullptr ? *order : local;
+
+	if (order == nullptr) o.degeneracyOrdering(G);
+
+	std::vector<int> core = coreNumbers(o);
+
+	Context ctx;
+
+	ctx.Sub.shareAdjacency(G);
+	ctx.reserve(G.n);
+	ctx.searchVertex(G, core, q);
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds> (
+		std::chrono::steady_clock::now() - startTimePoint);
+
+	log("Vertex query done! Two-hop neighbourhood: n=%d, Time spent: %ld ms", 
+		ctx.N2.size(), duration.count());
+
+	if (ctx.Ss.size() < k+2)
+		log("Warning: unable to find a defective clique with size larger than k+2.")
+
+	res.optimal = !timer.stopped();
+	res.Ss = ctx.Ss;
+	res.missingEdges = missingEdges(G, res.Ss);
+
+	logSet(res.Ss, "S*");
+
+	return res;
+}
+
+std::vector<int> defclique::profile(Graph &G, int k, int threads) {
+
+	TraceSpan span("profile");
+
+	log("Running vertex profile with %d thread(s)...", threads);
+
+	auto startTimePoint = std::chrono::steady_clock::now();
+
+	defclique::k = k;
+	defclique::mode = REDUCTION_SEARCH;
+
+	Ordering o;
+	o.degeneracyOrdering(G);
+
+	std::vector<int> core = coreNumbers(o);
+
+	// Solutions found so far, and for each vertex the largest one containing it
+	std::vector<std::vector<int>> found;
+	std::vector<int> best(G.n, -1);
+	std::atomic<int> numSearched(0);
+
+	// Dense vertices first, so that their large solutions seed the searches
+	// of the vertices they contain
+	#pragma omp parallel num_threads(threads)
+	{
+		Context ctx;
+
+		ctx.Sub.shareAdjacency(G);
+		ctx.reserve(G.n);
+		ctx.quiet = true;
+
+		#pragma omp for schedule(dynamic, 1)
+		for (int i = o.numOrdered-1; i >= 0; --i) {
+
+			if (timer.expired()) continue;
+
+			int v = o.ordered[i];
+
+			ctx.Ss.clear();
+			#pragma omp critical (profileBest)
+			if (best[v] != -1)
+				for (int w : found[best[v]]) ctx.Ss.push(w);
+
+			if (ctx.Ss.size() >= core[v]+k+1) continue;
+
+			int size = ctx.Ss.size();
+			ctx.searchVertex(G, core, v);
+			++numSearched;
+
+			if (ctx.Ss.size() > size) {
+				#pragma omp critical (profileBest)
+				{
+					found.emplace_back(ctx.Ss.begin(), ctx.Ss.end());
+					for (int w : ctx.Ss)
+						if (best[w] == -1 || found[best[w]].size() < ctx.Ss.size())
+							best[w] = found.size()-1;
+				}
+			}
+		}
+	}
+
+	// 0 for the ids that are not vertices of G, 1 for a vertex in no
+	// solution larger than itself
+	std::vector<int> res(G.n);
+	for (int v = 0; v < G.n; ++v)
+		res[v] = !G.V.inside(v) ? 0 : best[v] != -1 ? found[best[v]].size() : 1;
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds> (
+		std::chrono::steady_clock::now() - startTimePoint);
+
+	log("Vertex profile done! Searched vertices: %d/%d, Time spent: %ld ms", 
+		(int)numSearched, G.V.size(), duration.count());
+
+	if (timer.stopped())
+		log("Time limit reached, the profile is only a lower bound.");
+
+	return res;
+}
+
+// Calls report for each maximal solution with at least minSize vertices.
+// Each solution is found at its earliest vertex in the ordering, so the
+// roots are independent; report may raise minSize to prune the others.
+static void enumerateRoots(Graph &G, int k, std::atomic<int> &minSize, int threads, bool denseFirst,
+	const std::function<void(defclique::Context &, VertexSet &)> &report) {
+
+	defclique::k = k;
+	defclique::mode = REDUCTION_SEARCH;
+
+	// A threshold of at most 1 removes nothing, and G is used as it is
+	int threshold = minSize-k-1;
+	Graph reduced;
+	if (threshold > 1) reduced = defclique::coreReduction(G, threshold);
+	Graph &Core = threshold > 1 ? reduced : G;
+
+	Ordering o;
+	o.degeneracyOrdering(Core);
+
+	#pragma omp parallel num_threads(threads)
+	{
+		defclique::Context ctx;
+
+		ctx.Sub.shareAdjacency(G);
+		ctx.reserve(G.n);
+		ctx.onSolution = [&](VertexSet &S) { report(ctx, S); };
+
+		#pragma omp for schedule(dynamic, 1)
+		for (int i = 0; i < o.numOrdered; ++i) {
+
+			if (defclique::timer.expired()) continue;
+
+			int u = o.ordered[denseFirst ? o.numOrdered-1-i : i];
+
+			ctx.minSize = minSize;
+			if (o.value[u]+k+1 < ctx.minSize) continue;
+
+			ctx.preprocessing(Core, o, u, TWO_HOP);
+			if (ctx.C.size()+ctx.S.size() < ctx.minSize) continue;
+
+			for (int v : ctx.C)
+				if (ctx.S.size()-ctx.degS[v] > k) ctx.subC(v);
+
+			ctx.clr.graphColoring(ctx.Sub, ctx.minSize-k);
+			ctx.X.clear();
+			ctx.enumerate(Core, 0);
+		}
+	}
+}
+
+long long defclique::enumerate(Graph &G, int k, int minSize, FILE *out, int threads) {
+
+	TraceSpan span("enumerate");
+
+	// Solutions of at least k+2 vertices have diameter at most 2, which
+	// keeps the search of each root in its two-hop neighbourhood
+	if (minSize < k+2) {
+		minSize = k+2;
+		log("Warning: only solutions larger than k+1 are enumerated, using s=%d", minSize);
+	}
+
+	log("Enumerating maximal solutions with size>=%d, %d thread(s)...", minSize, threads);
+
+	auto startTimePoint = std::chrono::steady_clock::now();
+
+	std::atomic<int> threshold(minSize);
+	long long numFound = 0;
+
+	// Nothing is kept once a line is written
+	enumerateRoots(G, k, threshold, threads, false, [&](Context &ctx, VertexSet &S) {
+		std::vector<int> buf(S.begin(), S.end());
+		std::sort(buf.begin(), buf.end());
+		#pragma omp critical (enumerateOutput)
+		{
+			for (int i = 0; i < buf.size(); ++i)
+				fprintf(out, i > 0 ? " %d" : "%d", buf[i]);
+			fputc('\n', out);
+			++numFound;
+		}
+	});
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds> (
+		std::chrono::steady_clock::now() - startTimePoint);
+
+	log("Enumeration done! Solutions: %lld, Time spent: %ld ms", numFound, duration.count());
+
+	if (timer.stopped())
+		log("Time limit reached, the enumeration is incomplete.");
+
+	return numFound;
+}
+
+std::vector<defclique::Result> defclique::top(Graph &G, int k, int n, int threads) {
+
+	TraceSpan span("top");
+
+	log("Searching the %d largest maximal solutions with %d thread(s)...", n, threads);
+
+	auto startTimePoint = std::chrono::steady_clock::now();
+
+	// Min-heap on the size: its front is the n-th best solution, and only
+	// larger ones are searched once it is full
+	std::vector<std::vector<int>> heap;
+	auto smaller = [](const std::vector<int> &a, const std::vector<int> &b) { return a.size() > b.size(); };
+	std::atomic<int> threshold(k+2);
+
+	enumerateRoots(G, k, threshold, threads, true, [&](Context &ctx, VertexSet &S) {
+		#pragma omp critical (topHeap)
+		{
+			if (S.size() >= threshold) {
+				heap.emplace_back(S.begin(), S.end());
+				std::push_heap(heap.begin(), heap.end(), smaller);
+				if (heap.size() > n) {
+					std::pop_heap(heap.begin(), heap.end(), smaller);
+					heap.pop_back();
+				}
+				if (heap.size() == n)
+					threshold = std::max((int)threshold, (int)heap.front().size()+1);
+			}
+			ctx.minSize = threshold;
+		}
+	});
+
+	std::sort_heap(heap.begin(), heap.end(), smaller);
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds> (
+		std::chrono::steady_clock::now() - startTimePoint);
+
+	log("Top-%d search done! Found: %d, Time spent: %ld ms", n, (int)heap.size(), duration.count());
+
+	if (timer.stopped())
+		log("Time limit reached, the list may be incomplete.");
+
+	std::vector<Result> res(heap.size());
+	for (int i = 0; i < heap.size(); ++i) {
+		res[i].Ss.reserve(G.n);
+		for (int v : heap[i]) res[i].Ss.push(v);
+		res[i].optimal = !timer.stopped();
+		logSet(res[i].Ss, "S*[" + std::to_string(i+1) + "]");
+	}
+
+	return res;
 }
 
 #ifdef UPPERBOUND_FULL
-int defclique::upperbound() {
+int defclique::Context::upperbound() {
 	D.clear(); C1.clear();
 	int s = nnbS;
 	int posC = C.frontPos();
@@ -667,7 +1739,7 @@ int defclique::upperbound() {
 }
 
 #elif defined(UPPERBOUND_COLOR) // Color upperbound
-int defclique::upperbound() {
+int defclique::Context::upperbound() {
 	int cntClr = 0;
 	for (int v : S) cnD[clr.color[v]] = 0;
 	for (int v : C) cnD[clr.color[v]] = 0;
@@ -677,7 +1749,7 @@ int defclique::upperbound() {
 }
 
 #elif defined(UPPERBOUND_CORE) // Core upperbound
-int defclique::upperbound() {
+int defclique::Context::upperbound() {
 	C1.clear();
 	for (int v : S) { C1.push(v); degC1[v] = degS[v] + degC[v]; }
 	for (int v : C) { C1.push(v); degC1[v] = degS[v] + degC[v]; }
@@ -698,10 +1770,13 @@ int defclique::upperbound() {
 				}
 		}
 		else {
-			for (int v : C1)
-				if (Sub.connect(u, v) && --degC1[v] < Ss.size()-k) {
-					C1.pop(v);
-					q[tail++] = v;
+			for (const int *w = C1.begin(), *end = C1.end(); w < end; w += 64)
+				for (uint64_t adj = Sub.connectMask(u, w, std::min(64, (int)(end-w))); adj; adj &= adj-1) {
+					int v = w[__builtin_ctzll(adj)];
+					if (--degC1[v] < Ss.size()-k) {
+						C1.pop(v);
+						q[tail++] = v;
+					}
 				}
 		}
 	}
@@ -711,37 +1786,42 @@ int defclique::upperbound() {
 
 }
 #else // No upperbound
-int defclique::upperbound() {
+int defclique::Context::upperbound() {
 	return Ss.size()+1;
 }
 #endif
 
 
-void defclique::moveCToS(int v) {
+void defclique::Context::moveCToS(int v) {
 	nnbS += S.size() - degS[v];
 	add(Sub, S, degS, v);
 	sub(Sub, C, degC, v);
 }
 
-void defclique::moveSToC(int v) {
+void defclique::Context::moveSToC(int v) {
 	add(Sub, C, degC, v);
 	sub(Sub, S, degS, v);
 	nnbS -= S.size() - degS[v];
 }
 
-int defclique::updateC(int v) {
+int defclique::Context::updateC(int v) {
 	int posC = C.frontPos();
 	int sizeS = S.size() - (int)S.inside(v);
-	for (int u : C) {
-		if (u != v && nnbS + 2 * sizeS-degS[u]-degS[v] + (int)!Sub.connect(u, v) > k) {
-			sub(Sub, C, degC, u);
-			// nnbSub -= S.size()-degS[u] + C.size()-degC[u];
+	for (const int *w = C.begin(), *end = C.end(); w < end; w += 64) {
+		int cnt = std::min(64, (int)(end-w));
+		uint64_t adj = Sub.connectMask(v, w, cnt);
+		for (int i = 0; i < cnt; ++i) {
+			int u = w[i];
+			if (u != v && nnbS + 2 * sizeS-degS[u]-degS[v] + (int)!(adj >> i & 1) > k) {
+				sub(Sub, C, degC, u);
+				// nnbSub -= S.size()-degS[u] + C.size()-degC[u];
+			}
 		}
 	}
 	return posC;
 }
 
-void defclique::restoreC(int pos) {
+void defclique::Context::restoreC(int pos) {
 	for (int i = C.frontPos()-1; i >= pos; --i) {
 		int u = C[i];
 		// nnbSub += S.size()-degS[u] + C.size()-degC[u];
@@ -749,18 +1829,18 @@ void defclique::restoreC(int pos) {
 	}
 }
 
-int defclique::update(int v) {
+int defclique::Context::update(int v) {
 	int posC = updateC(v);
 	moveCToS(v);
 	return posC;
 }
 
-void defclique::restore(int v, int posC) {
+void defclique::Context::restore(int v, int posC) {
 	moveSToC(v);
 	restoreC(posC);
 }
 
-bool defclique::branch(int dep) {
+bool defclique::Context::branch(int dep) {
 
 #ifdef DEBUG_BRANCH
 
@@ -783,13 +1863,27 @@ bool defclique::branch(int dep) {
 
 #endif
 
+	if (timer.stopped())
+		return true;
+
+	if ((++numNodes & 1023) == 0) {
+		progress().update(numNodes, Ss.size());
+		if (timer.expired()) return true;
+	}
+
 	if (C.size() == 0) {
+		++branchStats.leaves;
 		if (S.size() > Ss.size()) {
 #ifdef DEBUG_BRANCH
 			log("*** New S*: size=%d", S.size());
 #endif
 			Ss.clear();
 			for (int v : S) Ss.push(v);
+			if (!quiet && label != nullptr) {
+				VertexSet original = originalIds(Ss, *label);
+				logIncumbent(original, "branch");
+			}
+			else if (!quiet) logIncumbent(Ss, "branch");
 				return mode == RUSSIANDOLL_SEARCH;
 		}
 		return false;
@@ -803,8 +1897,14 @@ bool defclique::branch(int dep) {
 	// 	}
 	// 	return false;
 	// }
-	if (S.size() + C.size() <= Ss.size() || upperbound() <= Ss.size()) 
+	if (S.size() + C.size() <= Ss.size()) {
+		++branchStats.prunedSize;
+		return false;
+	}
+	if (upperbound() <= Ss.size()) {
+		++branchStats.prunedBound;
 		return false;
+	}
 
 	C1.clear();
 	for (int v : C) {
@@ -820,13 +1920,19 @@ bool defclique::branch(int dep) {
 			C1.pop(v);
 		}
 	}
+	if (C.frontPos() != initPosC) ++branchStats.fired[RULE_FORCED];
 
-	if (C.size() == 0) branch(dep+1);
+	if (C.size() == 0) {
+		++branchStats.children[RULE_FORCED];
+		branch(dep+1);
+	}
 	else do {
 		bool flagReturn = false;
 		// 1 non-neighbor
 		for (int v : C1) {
 			if ((S.size() - degS[v]) + (C.size() - degC[v]) == 2) {
+				++branchStats.fired[RULE_ONE_NON_NBR];
+				++branchStats.children[RULE_ONE_NON_NBR];
 				int posC = update(v);
 				if (branch(dep+1)) return true;
 				restore(v, posC);
@@ -840,6 +1946,8 @@ bool defclique::branch(int dep) {
 		// 2 non-neighbors
 		for (int v : C1) {
 			if ((S.size() - degS[v]) + (C.size() - degC[v]) == 3) {
+				++branchStats.fired[RULE_TWO_NON_NBR];
+				++branchStats.children[RULE_TWO_NON_NBR];
 				int posC = update(v);
 				if (branch(dep+1)) return true;
 				restore(v, posC);
@@ -858,6 +1966,7 @@ bool defclique::branch(int dep) {
 							}
 						moveCToS(u);
 						moveCToS(w);
+						++branchStats.children[RULE_TWO_NON_NBR];
 						if (branch(dep+1)) return true;
 						moveSToC(w);
 						moveSToC(u);
@@ -873,6 +1982,7 @@ bool defclique::branch(int dep) {
 								subC(w);
 							}
 						moveCToS(u);
+						++branchStats.children[RULE_TWO_NON_NBR];
 						if (branch(dep+1)) return true;
 						moveSToC(u);
 					}
@@ -886,22 +1996,26 @@ bool defclique::branch(int dep) {
 		if (flagReturn) break;
 
 		if (C.size() > C1.size()) { // Bipartite
+			++branchStats.fired[RULE_BIPARTITE];
 			int u = C[C.frontPos()];
 			for (int v : C) {
 				if (degS[v] < degS[u])
 					u = v;
 			}
 			int posC = update(u);
+			++branchStats.children[RULE_BIPARTITE];
 			if (branch(dep+1)) return true;
 			restore(u, posC);
 
 			subC(u);
+			++branchStats.children[RULE_BIPARTITE];
 			if (branch(dep+1)) return true;
 			addC(u);
 		}
 
 
 		else { // Pivoting 
+			++branchStats.fired[RULE_PIVOT];
 			int posC = C.frontPos();
 			int u = C1[C1.frontPos()];
 			for (int v : C1) {
@@ -912,17 +2026,23 @@ bool defclique::branch(int dep) {
 
 			std::vector<int> P1 = {u}, P2;
 			bool flagNnbSu = S.size()-degS[u] == 1;
-			for (int v : C) {
-				if (v != u && !Sub.connect(u, v)) {
-					if (flagNnbSu && S.size() == degS[v])
-						P1.push_back(v);
-					else
-						P2.push_back(v);
+			for (const int *w = C.begin(); w < C.end(); w += 64) {
+				int cnt = std::min(64, (int)(C.end()-w));
+				uint64_t adj = Sub.connectMask(u, w, cnt);
+				for (int i = 0; i < cnt; ++i) {
+					int v = w[i];
+					if (v != u && !(adj >> i & 1)) {
+						if (flagNnbSu && S.size() == degS[v])
+							P1.push_back(v);
+						else
+							P2.push_back(v);
+					}
 				}
 			}
 
 			for (int v : P1) {
 				int posC2 = update(v);
+				++branchStats.children[RULE_PIVOT];
 				if (branch(dep+1)) return true;
 				restore(v, posC2);
 				subC(v);
@@ -933,6 +2053,7 @@ bool defclique::branch(int dep) {
 				for (int w : P2)
 					if (C.inside(w) && Sub.connect(v, w)) {
 						int posC3 = update(w);
+						++branchStats.children[RULE_PIVOT];
 						if (branch(dep+1)) return true;
 						restore(w, posC3);
 						subC(w);
@@ -955,6 +2076,176 @@ bool defclique::branch(int dep) {
 	return false;
 }
 
+// Lists the maximal solutions of the current root with at least minSize
+// vertices. Binary branching on the candidates; X keeps the excluded ones,
+// which a maximal solution must not be able to take.
+bool defclique::Context::enumerate(Graph &G, int dep) {
+
+	if (timer.stopped() || ((++numNodes & 1023) == 0 && timer.expired()))
+		return true;
+
+	if (S.size() + C.size() < minSize)
+		return false;
+
+	// An excluded vertex adjacent to all of S and C extends every solution here
+	for (int x : X)
+		if (degS[x] == S.size() && degC[x] == C.size())
+			return false;
+
+	if (C.size() == 0) {
+		for (int x : X)
+			if (nnbS + S.size() - degS[x] <= k)
+				return false;
+		if (maximal(G) && onSolution) onSolution(S);
+		return false;
+	}
+
+	if (upperbound() < minSize)
+		return false;
+
+	int u = C[C.frontPos()];
+	for (int v : C) {
+		if (degS[v] < degS[u])
+			u = v;
+	}
+
+	int posC = update(u);
+	if (enumerate(G, dep+1)) return true;
+	restore(u, posC);
+
+	subC(u);
+	X.push(u);
+	if (enumerate(G, dep+1)) return true;
+	X.pop(u);
+	addC(u);
+
+	return false;
+}
+
+// Whether no vertex of G outside the sub-problem, e.g. one ordered before
+// the root, can join S
+bool defclique::Context::maximal(Graph &G) {
+	bool res = true;
+	for (int v : S)
+		for (int w : G.nbr[v]) ++degSs[w];
+	for (int v : S) {
+		for (int w : G.nbr[v])
+			if (!S.inside(w) && nnbS + S.size() - degSs[w] <= k) {
+				res = false;
+				break;
+			}
+		if (!res) break;
+	}
+	for (int v : S)
+		for (int w : G.nbr[v]) degSs[w] = 0;
+	return res;
+}
+
+int defclique::missingEdges(Graph &G, VertexSet &S) {
+	int cnt = 0;
+	for (int v : S)
+		for (int w : S)
+			if (v < w && !G.connect(v, w)) ++cnt;
+	return cnt;
+}
+
+// Resident set size in KB, 0 if unknown
+long defclique::currentMemory() {
+	FILE *fp = fopen("/proc/self/statm", "r");
+	if (fp == nullptr) return 0;
+	long pages = 0, resident = 0;
+	if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) resident = 0;
+	fclose(fp);
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Peak resident set size of the process in KB
+long defclique::peakMemory() {
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	return usage.ru_maxrss;
+}
+
+// s as a quoted JSON string
+std::string defclique::jsonString(const std::string &s) {
+	std::string res = "\"";
+	for (char c : s) {
+		if (c == '"' || c == '\\') res += std::string("\\") + c;
+		else if (c == '\n') res += "\\n";
+		else if (c == '\t') res += "\\t";
+		else if (c == '\r') res += "\\r";
+		else if ((unsigned char)c < 0x20) {
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			res += buf;
+		}
+		else res += c;
+	}
+	return res + "\"";
+}
+
+// One JSON object describing a run, without a trailing newline
+void defclique::writeJson(FILE *fp, const std::string &filename, int k, const std::string &algo, const Result &res, long totalTime) {
+	static const char *names[NUM_RULES] = {"forced", "one_non_nbr", "two_non_nbr", "bipartite", "pivot"};
+	const Stats &st = res.stats;
+
+	fprintf(fp, "{\"graph\": {\"path\": %s, \"n\": %d, \"m\": %d, \"max_degree\": %d}, ",
+		jsonString(filename).c_str(), res.n, res.m, res.maxDeg);
+	fprintf(fp, "\"k\": %d, \"algo\": %s, ", k, jsonString(algo).c_str());
+	fprintf(fp, "\"timings_ms\": {\"load\": %ld, \"heuristic\": %ld, \"reduction\": %ld, \"ordering\": %ld, "
+		"\"preprocess\": %ld, \"branch\": %ld, \"total\": %ld}, ",
+		st.loadTime, st.heuristicTime, st.reductionTime, st.orderingTime, st.preprocessTime, st.branchTime, totalTime);
+	fprintf(fp, "\"memory_peak_kb\": %ld, \"nodes\": %lld, \"branch\": {", peakMemory(), st.numNodes);
+	for (int r = 0; r < NUM_RULES; ++r)
+		fprintf(fp, "\"%s\": {\"fired\": %lld, \"children\": %lld}, ", names[r], st.branch.fired[r], st.branch.children[r]);
+	fprintf(fp, "\"leaves\": %lld, \"pruned_size\": %lld, \"pruned_bound\": %lld}, ",
+		st.branch.leaves, st.branch.prunedSize, st.branch.prunedBound);
+
+	if (perfCounters().active()) {
+		static const char *events[NUM_PERF_EVENTS] = {"cycles", "instructions", "llc_misses", "branch_misses"};
+		const char *phases[] = {"load", "heuristic", "reduction", "ordering", "preprocess", "branch"};
+		const PerfSample *counters[] = {&st.loadCounters, &st.heuristicCounters, &st.reductionCounters,
+			&st.orderingCounters, &st.preprocessCounters, &st.branchCounters};
+		fprintf(fp, "\"counters\": {");
+		for (int p = 0; p < 6; ++p) {
+			fprintf(fp, "%s\"%s\": {", p > 0 ? ", " : "", phases[p]);
+			for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+				if (counters[p]->value[e] < 0) fprintf(fp, "%s\"%s\": null", e > 0 ? ", " : "", events[e]);
+				else fprintf(fp, "%s\"%s\": %lld", e > 0 ? ", " : "", events[e], counters[p]->value[e]);
+			}
+			fprintf(fp, "}");
+		}
+		fprintf(fp, "}, ");
+	}
+
+	std::vector<int> S(res.Ss.begin(), res.Ss.end());
+	std::sort(S.begin(), S.end());
+	fprintf(fp, "\"size\": %d, \"solution\": [", (int)S.size());
+	for (int i = 0; i < S.size(); ++i)
+		fprintf(fp, i > 0 ? ", %d" : "%d", S[i]);
+	fprintf(fp, "], \"missing_edges\": %d, \"optimal\": %s}", res.missingEdges, res.optimal ? "true" : "false");
+}
+
+void defclique::BranchStats::add(const BranchStats &other) {
+	for (int r = 0; r < NUM_RULES; ++r) {
+		fired[r] += other.fired[r];
+		children[r] += other.children[r];
+	}
+	leaves += other.leaves;
+	prunedSize += other.prunedSize;
+	prunedBound += other.prunedBound;
+}
+
+// Fired/children of each rule, then the leaves and pruned nodes
+std::string defclique::BranchStats::toString() const {
+	static const char *names[NUM_RULES] = {"forced", "1-non-nbr", "2-non-nbr", "bipartite", "pivot"};
+	std::stringstream ss;
+	for (int r = 0; r < NUM_RULES; ++r)
+		ss << names[r] << "=" << fired[r] << "/" << children[r] << ", ";
+	ss << "leaves=" << leaves << ", pruned by size=" << prunedSize << ", pruned by bound=" << prunedBound;
+	return ss.str();
+}
+
 void defclique::add(Graph &G, VertexSet &V, std::vector<int> &degV, int v) {
 	//if (V.inside(v)) return;
 	V.push(v);
@@ -969,12 +2260,12 @@ void defclique::sub(Graph &G, VertexSet &V, std::vector<int> &degV, int v) {
 		--degV[w];
 }
 
-void defclique::addC(int v) {
+void defclique::Context::addC(int v) {
 	// nnbSub += S.size()-degS[v] + C.size()-degC[v];
 	add(Sub, C, degC, v);
 }
 
-void defclique::subC(int v) {
+void defclique::Context::subC(int v) {
 	sub(Sub, C, degC, v);
 	// nnbSub -= S.size()-degS[v] + C.size()-degC[v];
 }
@@ -4,33 +4,172 @@
 #include "../utils/graph.hpp"
 #include "../utils/vertexset.hpp"
 #include "../utils/ordering.hpp"
+#include "../utils/coloring.hpp"
+#include "../utils/timer.hpp"
+#include "../utils/perf.hpp"
 #include <cstdint>
+#include <cstdio>
 #include <string>
+#include <random>
+#include <functional>
 
 #define RUSSIANDOLL_SEARCH 0
 #define REDUCTION_SEARCH 1
 #define ONE_HOP 0
 #define TWO_HOP 1
+#define RULE_FORCED 0		// candidates missing at most one edge, moved to S
+#define RULE_ONE_NON_NBR 1
+#define RULE_TWO_NON_NBR 2
+#define RULE_BIPARTITE 3
+#define RULE_PIVOT 4
+#define NUM_RULES 5
 
 namespace defclique {
+
+	struct Options {
+		int threads = 1;	// number of threads used by the heuristic
+		int restarts = 0;	// randomized greedy restarts per heuristic root
+		long lsTime = 0;	// time budget of the local search in ms, 0 to disable
+		long timeLimit = 0;	// time limit of the whole run in ms, 0 for no limit
+		std::string checkpoint;	// checkpoint file, empty to disable
+		long checkpointInterval = 60000;	// ms between two checkpoints
+		bool resume = false;	// resume from the checkpoint file
+		bool branchStats = false;	// log the branch statistics of every root
+		bool traceRoots = false;	// trace every root of the search, not only the phases
+		std::string rootCosts;	// CSV of the most expensive roots, empty to disable
+		int rootCostsTop = 20;	// number of roots written to rootCosts
+		bool memoryStats = false;	// log the memory held by the graphs and the search after each phase
+		int vertex = -1;	// only search solutions containing this vertex, -1 to disable
+		bool relabel = false;	// search a copy of the core renumbered by its ordering
+	};
+
+	// How often each rule of branch fires and how many children it spawns,
+	// and how often a node is cut by the size or the upper bound
+	struct BranchStats {
+		long long fired[NUM_RULES] = {}, children[NUM_RULES] = {};
+		long long leaves = 0, prunedSize = 0, prunedBound = 0;
+
+		void add(const BranchStats &other);
+		std::string toString() const;
+	};
+
+	// Cost of the search from a single root
+	struct RootCost {
+		int root;
+		long long preprocessTime, branchTime;	// us
+		int candidates;		// |C| after preprocessing
+		int colors;			// colours of the sub-problem, 0 if it was pruned
+		long long numNodes;
+	};
+
+	// Time spent in each phase of solve, in ms
+	struct Stats {
+		long loadTime = 0;			// reading the graph
+		long heuristicTime = 0;		// initial heuristic and local search
+		long reductionTime = 0;		// core reduction
+		long orderingTime = 0;		// degeneracy ordering of the core, and its relabelling
+		long preprocessTime = 0;	// building the sub-problem of each root
+		long branchTime = 0;
+		long sweepTime = 0;			// one k of a sweep, including the load for the first
+		long long numNodes = 0;		// branch-and-bound nodes
+		BranchStats branch;
+		// Hardware counters of the same phases, if enabled
+		PerfSample loadCounters, heuristicCounters, reductionCounters,
+			orderingCounters, preprocessCounters, branchCounters;
+	};
+
+	struct Result {
+		VertexSet Ss;		// best defective clique found
+		bool optimal;		// false if the search was cut by the time limit
+		int missingEdges = 0;	// missing edges in Ss
+		int n = 0, m = 0, maxDeg = 0;	// the input graph
+		Stats stats;
+	};
+
+	// Kept between solves on the same graph, by sweeps and by the server
+	struct Cache {
+		VertexSet Ss;			// initial incumbent, e.g. the optimum of the previous k
+		int threshold = -1;		// degree threshold Core was reduced with
+		bool ordered = false;	// whether o is the ordering of Core
+		bool orderedG = false;	// whether oG is the ordering of G
+		bool relabelled = false;	// whether Relabelled is the relabelled Core
+		Graph Core, Relabelled;
+		Ordering o, oG, oRelabelled;
+		std::vector<int> label, id;	// original id of each new id of Relabelled, and the inverse
+	};
+
+	extern int k, mode;		// parameters of the current search, read by Context
+	extern Timer timer;
+	extern std::function<void(VertexSet &, const std::string &)> onIncumbent;
+
+	// Search state of a single thread: the sub-problem around the current root,
+	// the partial solution S, the candidates C and the incumbent S*.
+	struct Context {
+		int nnbS;
+		long long numNodes = 0;
+		BranchStats branchStats;
+		bool quiet = false;	// do not log new incumbents
+		int minSize = 0;	// do not search solutions smaller than this
+		const std::vector<int> *label = nullptr;	// original ids of a relabelled graph, for the log
+		Graph Sub;
+		Coloring clr;
+		VertexSet S, C, Ss, C1, D;
+		std::vector<int> degC1, degC, degS, cnD;
+		std::vector<int> q;
+		std::mt19937 rng;
+		VertexSet N2;		// two-hop neighbourhood of a query vertex
+		std::vector<int> degN2, degSs;
+		Ordering oHop, oSub;
+		VertexSet X;		// candidates excluded while enumerating
+		std::function<void(VertexSet &)> onSolution;
+
+		// Size a solution must exceed to be searched
+		int bound() const { return std::max(Ss.size(), minSize-1); }
+
+		void reserve(int n);
+		void preprocessing(Graph &G, Ordering &o, int u, int mode=TWO_HOP);
+		void heuristic(Graph &G, Ordering &o, Ordering &oSub, int u, int restarts=0);
+		void searchVertex(Graph &G, std::vector<int> &core, int target);
+		template<typename Select>
+		void greedy(Graph &G, VertexSet &P, std::vector<int> &degP, Select select);
+		int upperbound();
+		void moveCToS(int v);
+		void moveSToC(int v);
+		int updateC(int v);
+		void restoreC(int pos);
+		int update(int v);
+		void restore(int v, int posC);
+		bool branch(int dep);
+		bool enumerate(Graph &G, int dep);
+		bool maximal(Graph &G);
+		void addC(int v);
+		void subC(int v);
+	};
+
 	void logSet(VertexSet &V, const std::string &name);
+	void logIncumbent(VertexSet &V, const std::string &phase);
 	Graph coreReduction(Graph &G, int k);
 	Graph edgeReduction(Graph &G, int k);
-	void preprocessing(Graph &G, Ordering &o, int u, int mode=TWO_HOP);
-	VertexSet heuristic(Graph &G, int k);
-	int upperbound();
-	void run(const std::string &filename, int k, int mode=REDUCTION_SEARCH);
-	void moveCToS(int v);
-	void moveSToC(int v);
-	int updateC(int v);
-	void restoreC(int pos);
-	int update(int v);
-	void restore(int v, int posC);
-	bool branch(int dep);
+	VertexSet heuristic(Graph &G, int k, int threads=1, int restarts=0, Ordering *order=nullptr);
+	VertexSet localSearch(Graph &G, VertexSet &init, int k, long timeBudget);
+	Result solve(Graph &G, int k, int mode=REDUCTION_SEARCH, const Options &opt=Options(), Cache *cache=nullptr);
+	Result solveVertex(Graph &G, int k, int q, Ordering *order=nullptr);
+	Result run(const std::string &filename, int k, int mode=REDUCTION_SEARCH, const Options &opt=Options());
+	std::vector<int> profile(Graph &G, int k, int threads=1);
+	std::vector<int> profile(const std::string &filename, int k, const std::string &output, const Options &opt=Options());
+	long long enumerate(Graph &G, int k, int minSize, FILE *out, int threads=1);
+	long long enumerate(const std::string &filename, int k, int minSize, const std::string &output, const Options &opt=Options());
+	std::vector<Result> top(Graph &G, int k, int n, int threads=1);
+	std::vector<Result> top(const std::string &filename, int k, int n, const Options &opt=Options());
+	std::vector<Result> sweep(const std::string &filename, int maxK, int mode=REDUCTION_SEARCH, const Options &opt=Options());
+	void extend(Graph &G, VertexSet &Ss, int k, std::vector<int> &degS);
+	int missingEdges(Graph &G, VertexSet &S);
+	long peakMemory();
+	long currentMemory();
+	std::string jsonString(const std::string &s);
+	void writeJson(FILE *fp, const std::string &filename, int k, const std::string &algo, const Result &res, long totalTime);
 	void add(Graph &G, VertexSet &V, std::vector<int> &degV, int v);
 	void sub(Graph &G, VertexSet &V, std::vector<int> &degV, int v);
-	void addC(int v);
-	void subC(int v);
 }
 
 #endif // DEFCLIQUE_H
@@ -1,21 +1,27 @@
 #include "kdbb.h"
 #include "pmc/pmc.h"
+#include "../utils/trace.hpp"
+#include "../utils/progress.hpp"
 #include <chrono>
 #include <chrono>
 #include <omp.h>
 #include <queue>
 #include <algorithm>
+#include <cmath>
 
 namespace kdbb {
-	VertexSet S, C;
+	VertexSet S, C, Ss;	// Ss is the best solution, of size lb once one is known
 	std::vector<int> degS, degC;
 	int k, nnbS, lb, numBranches, numBound;
+	double explored;	// fraction of the search tree done, a child having half the share of its parent
 	Graph G;
 	std::vector<int> bin;
+	Timer timer;
 }
 
 
 Graph kdbb::preprocessing(Graph &G, int k, int lb) {
+	TraceSpan span("preprocessing");
 	fprintf(stderr, "Preprocessing......");
 	Graph C = coreReduction(G, lb-k);
 	C = edgeReduction(C, lb-k-1);
@@ -25,6 +31,7 @@ Graph kdbb::preprocessing(Graph &G, int k, int lb) {
 
 Graph kdbb::coreReduction(Graph& G, int k) {
 	if (k <= 1) return G;
+	TraceSpan span("coreReduction");
 
 	std::queue<int> q;
 	std::vector<bool> vis(G.n);
@@ -49,22 +56,26 @@ Graph kdbb::coreReduction(Graph& G, int k) {
 		}
 	}
 
-	Graph C;
+	std::vector<std::pair<int, int>> edges;
 
 	for (int u : G.V) {
 		if (vis[u]) continue;
 		for (int v : G.nbr[u]) {
 			if (vis[v]) continue;
-			C.addEdge(u, v);
+			edges.push_back(std::make_pair(u, v));
 		}
 	}
 
+	Graph C;
+	C.build(0, edges);
+
 	return C;
 }
 
 
 
 Graph kdbb::edgeReduction(Graph &G, int k) {
+	TraceSpan span("edgeReduction");
 	std::vector<int> cn(G.m), q(G.m);
 	std::vector<std::pair<int, int>> edges;
 	std::vector<std::unordered_map<int, int>> eid(G.n);	
@@ -87,7 +98,7 @@ Graph kdbb::edgeReduction(Graph &G, int k) {
 		vis[id] = true;
 		// cn[id] = 0;
 		int u = edges[id].first, v = edges[id].second;
-		if (G.nbr[u] > G.nbr[v]) std::swap(u, v);
+		if (G.nbr[u].size() > G.nbr[v].size()) std::swap(u, v);
 		for (int w : G.nbr[u])
 			if (G.connect(v, w)) {
 				int i = eid[u][w], j = eid[v][w];
@@ -112,7 +123,7 @@ Graph kdbb::edgeReduction(Graph &G, int k) {
 	while (head < tail) {
 		int i = q[head++];
 		int u = edges[i].first, v = edges[i].second;
-		if (G.nbr[u] > G.nbr[v]) std::swap(u, v);
+		if (G.nbr[u].size() > G.nbr[v].size()) std::swap(u, v);
 		for (int w : G.nbr[u]) {
 			if (G.connect(v, w)) {
 				int i = eid[u][w], j = eid[v][w];
@@ -128,24 +139,30 @@ Graph kdbb::edgeReduction(Graph &G, int k) {
 		}
 	}
 
-	Graph E;
+	std::vector<std::pair<int, int>> kept;
 
 	for (int i = 0; i < edges.size(); ++i) {
 		if (vis[i]) continue;
-		E.addEdge(edges[i].first, edges[i].second);
+		kept.push_back(edges[i]);
 	}
 
+	Graph E;
+	E.build(0, kept);
+
 	return E;
 
 }
 
 
-int kdbb::fastLB(std::string filename) {
+int kdbb::fastLB(std::string filename, std::vector<int> *clique) {
+	TraceSpan span("fastLB");
 	auto startTimePoint = std::chrono::steady_clock::now();
     pmc::pmc_graph G(filename);
     input in;
     in.graph = filename;
     in.threads = std::min(8, omp_get_max_threads());
+    if (timer.limited())
+        in.time_limit = timer.remaining() / 1000.0;
     G.compute_cores();
     in.ub = G.get_max_core() + 1;
     std::vector<int> C;
@@ -155,6 +172,7 @@ int kdbb::fastLB(std::string filename) {
 	    auto duration = std::chrono::duration_cast<chrono::milliseconds>(
 			std::chrono::steady_clock::now() - startTimePoint);
     	fprintf(stderr, "PMC result: size=%d, time=%ld ms\n", in.lb, duration.count());
+    	if (clique != nullptr) *clique = C;
     	return in.lb;
     }
     if (G.num_vertices() < in.adj_limit) {
@@ -169,48 +187,117 @@ int kdbb::fastLB(std::string filename) {
     auto duration = std::chrono::duration_cast<chrono::milliseconds>(
 		std::chrono::steady_clock::now() - startTimePoint);
     fprintf(stderr, "PMC result: size=%d, time=%ld ms\n", C.size(), duration.count());
+    if (clique != nullptr) *clique = C;
     return C.size();
 }
 
+void printSet(VertexSet &V, const std::string &name) {
+	std::vector<int> S(V.begin(), V.end());
+	std::sort(S.begin(), S.end());
+	std::stringstream ss;
+	ss << "{";
+	for (int i = 0; i < S.size(); ++i) {
+		if (i > 0) ss << ",";
+		ss << S[i];
+	}
+	ss << "}";
+	fprintf(stderr, "%s: size=%d, content=%s\n", 
+		name.c_str(), V.size(), ss.str().c_str());
+}
 
-int kdbb::run(std::string filename, int k) {
+// Greedily adds vertices of G to Ss while it misses at most k edges, up to
+// size vertices. Ss is dropped if it already misses more.
+static void grow(Graph &G, VertexSet &Ss, int k, int size) {
+	int missing = 0;
+	for (int v : Ss)
+		for (int w : Ss)
+			if (v < w && !G.connect(v, w)) ++missing;
+	if (missing > k) {
+		Ss.clear();
+		missing = 0;
+	}
+	for (int v : G.V) {
+		if (Ss.size() >= size) break;
+		if (Ss.inside(v)) continue;
+		int miss = 0;
+		for (int w : Ss)
+			if (!G.connect(v, w)) ++miss;
+		if (missing + miss > k) continue;
+		Ss.push(v);
+		missing += miss;
+	}
+}
+
+
+kdbb::Result kdbb::run(std::string filename, int k, long timeLimit, Stats *stats) {
 	// TODO: FastLB
-	Graph inputG(filename);
-	lb = fastLB(filename);
+	timer.start(timeLimit);
+	TraceSpan span("kdbb", "phase", "k", k);
+	auto loadStartTimePoint = std::chrono::steady_clock::now();
+	Graph inputG;
+	{
+		TraceSpan loadSpan("load");
+		inputG.loadFromFile(filename);
+	}
+	auto lbStartTimePoint = std::chrono::steady_clock::now();
+	std::vector<int> clique;
+	lb = fastLB(filename, &clique);
 	lb = std::max(lb, k+1);
 	kdbb::k = k;
+	// PMC numbers the vertices from 1 down to 0 when the file has no vertex
+	// 0. Its clique seeds Ss, grown up to lb if k+1 is larger.
+	int shift = inputG.V.inside(0) ? 0 : 1;
+	Ss.reserve(inputG.n);
+	Ss.clear();
+	for (int v : clique)
+		if (v + shift < inputG.n) Ss.push(v + shift);
+	grow(inputG, Ss, k, lb);
+	auto reductionStartTimePoint = std::chrono::steady_clock::now();
 	G = preprocessing(inputG, k, lb);
 	S.reserve(G.n);
 	C.reserve(G.n);
+	S.clear();
+	C.clear();
 	degS.resize(G.n);
 	degC.resize(G.n);
 	bin.resize(G.maxDeg+1);
 	auto startTimePoint = std::chrono::steady_clock::now();
 	for (int v : G.V) C.push(v);
 	nnbS = numBranches = numBound = 0;
-	branch(0, -1);
-	auto duration = std::chrono::duration_cast<chrono::milliseconds>(
-		std::chrono::steady_clock::now() - startTimePoint);
-	fprintf(stderr, "KDBB result: size=%d, time=%ld ms, numBranches=%d, numBound=%d\n", lb, duration.count(), numBranches, numBound);
-	return lb;
-}
-
-void printSet(VertexSet &V, const std::string &name) {
-	std::vector<int> S(V.begin(), V.end());
-	std::sort(S.begin(), S.end());
-	std::stringstream ss;
-	ss << "{";
-	for (int i = 0; i < S.size(); ++i) {
-		if (i > 0) ss << ",";
-		ss << S[i];
+	explored = 0;
+	progress().start("KDBB");
+	{
+		TraceSpan branchSpan("branch");
+		branch(0, -1);
 	}
-	ss << "}";
-	fprintf(stderr, "%s: size=%d, content=%s\n", 
-		name.c_str(), V.size(), ss.str().c_str());
+	progress().stop();
+	auto endTimePoint = std::chrono::steady_clock::now();
+	auto duration = std::chrono::duration_cast<chrono::milliseconds>(endTimePoint - startTimePoint);
+	Result res;
+	res.Ss = Ss;
+	res.optimal = !timer.stopped() && Ss.size() >= lb;
+	fprintf(stderr, "KDBB result: size=%d, optimal=%s, time=%ld ms, numBranches=%d, numBound=%d\n", 
+		Ss.size(), res.optimal ? "yes" : "no", duration.count(), numBranches, numBound);
+	printSet(Ss, "S*");
+	if (stats != nullptr) {
+		auto ms = [](std::chrono::steady_clock::duration d) {
+			return (long)std::chrono::duration_cast<chrono::milliseconds>(d).count();
+		};
+		stats->loadTime = ms(lbStartTimePoint - loadStartTimePoint);
+		stats->heuristicTime = ms(reductionStartTimePoint - lbStartTimePoint);
+		stats->reductionTime = ms(startTimePoint - reductionStartTimePoint);
+		stats->branchTime = duration.count();
+		stats->numNodes = numBranches;
+	}
+	return res;
 }
 
 void kdbb::branch(int dep, int u) {
 	++numBranches;
+	// Nodes are expensive enough to be published one by one
+	progress().update(numBranches, lb);
+	progress().setFraction(explored);
+	if (timer.expired()) return;
 
 	auto numNbrS = [&](int v) {
 		int cnt = 0;
@@ -288,7 +375,10 @@ void kdbb::branch(int dep, int u) {
 	// printSet(C, "C");
 
 
-	if (nnbS > k) return;
+	if (nnbS > k) {
+		explored += std::ldexp(1.0, -dep);
+		return;
+	}
 
 	int posC = C.frontPos();
 
@@ -352,12 +442,19 @@ void kdbb::branch(int dep, int u) {
 	do {
 
 		if (C.size() == 0) {
-			lb = std::max(lb, S.size());
+			if (S.size() > lb) {
+				lb = S.size();
+				Ss.clear();
+				for (int v : S) Ss.push(v);
+				fprintf(stderr, "New lb: size=%d, time=%ld ms\n", lb, timer.elapsed());
+			}
+			explored += std::ldexp(1.0, -dep);
 			break;
 		}
 
 		if (candibound() <= lb) {
 			++numBound;
+			explored += std::ldexp(1.0, -dep);
 			break;
 		}
 
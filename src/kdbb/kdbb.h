@@ -5,20 +5,35 @@
 
 #include "../utils/graph.hpp"
 #include "../utils/vertexset.hpp"
+#include "../utils/timer.hpp"
 #include <string>
 #include <vector>
 
 
 namespace kdbb {
+	// Time spent in each phase of run, in ms
+	struct Stats {
+		long loadTime = 0;
+		long heuristicTime = 0;		// PMC lower bound, which reads the file again
+		long reductionTime = 0;		// core and edge reduction
+		long branchTime = 0;
+		long long numNodes = 0;
+	};
+
+	struct Result {
+		VertexSet Ss;		// best defective clique found
+		bool optimal;		// false if the search was cut by the time limit
+	};
+
 	int upperbound();
-	int fastLB(std::string filename);
+	int fastLB(std::string filename, std::vector<int> *clique=nullptr);
 	Graph preprocessing(Graph &G, int k, int lb);
 	Graph coreReduction(Graph &G, int k);
 	Graph edgeReduction(Graph &G, int k);
-	int run(std::string filename, int k);
+	Result run(std::string filename, int k, long timeLimit=0, Stats *stats=nullptr);
 	void branch(int dep, int v);
 }
 
 
 
-#endif
\ No newline at end of file
+#endif
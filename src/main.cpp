@@ -1,7 +1,11 @@
 #include "defclique/defclique.h"
 #include "kdbb/kdbb.h"
+#include "server/server.h"
 #include "utils/bigraph.hpp"
 #include "utils/log.hpp"
+#include "utils/perf.hpp"
+#include "utils/progress.hpp"
+#include "utils/trace.hpp"
 #include <chrono>
 #include <cstdint>
 #include <iostream>
@@ -15,8 +19,34 @@ int main(int argc, char* argv[]) {
 	cmdline::parser args;
 
 	args.add<std::string>("data", 'd', "dataset path", true, "");
-	args.add<int>("key", 'k', "value of k", true, 1);
+	args.add<int>("key", 'k', "value of k (not needed by the server)", false, 1);
 	args.add<std::string>("algo", 'a', "algorithm", false, "MDC", cmdline::oneof<std::string>("MDC", "RussianDoll", "KDBB", "PMC"));
+	args.add<int>("threads", 't', "number of threads for loading the graph and the heuristic", false, 1);
+	args.add<int>("restarts", 'r', "randomized heuristic restarts per root", false, 0);
+	args.add<long>("ls-time", 'l', "time budget of local search in ms", false, 0);
+	args.add<long>("time-limit", '\0', "time limit in ms, 0 for no limit", false, 0);
+	args.add<std::string>("checkpoint", 'c', "checkpoint file", false, "");
+	args.add<long>("checkpoint-interval", '\0', "time between checkpoints in ms", false, 60000);
+	args.add("resume", '\0', "resume from the checkpoint file");
+	args.add<std::string>("trace", '\0', "write a Chrome trace-event JSON of the phases to this file", false, "");
+	args.add("trace-roots", '\0', "also trace every root of the search");
+	args.add("branch-stats", '\0', "log the branch statistics of every root");
+	args.add<std::string>("root-costs", '\0', "log a histogram of the cost of the roots and write the most expensive ones to this CSV file", false, "");
+	args.add<int>("root-costs-top", '\0', "number of roots written by --root-costs", false, 20);
+	args.add("perf-counters", '\0', "count cycles, instructions, LLC and branch misses of each phase");
+	args.add("memory-stats", '\0', "log the memory held by the graphs and the search after each phase, with the RSS");
+	args.add("relabel", '\0', "renumber the core by its degeneracy ordering before the search, for MDC and RussianDoll");
+	args.add<long>("progress", '\0', "log the progress of the search with an estimated remaining time every given ms, 0 to disable", false, 0);
+	args.add("sweep", 's', "solve for every value from 0 to k");
+	args.add<int>("vertex", 'q', "only search solutions containing this vertex", false, -1);
+	args.add<std::string>("profile", 'p', "write the largest solution size containing each vertex to this file (.csv or binary)", false, "");
+	args.add<std::string>("enumerate", 'e', "write all maximal solutions with at least --min-size vertices to this file", false, "");
+	args.add<int>("min-size", '\0', "minimum size of the enumerated solutions", false, 0);
+	args.add<int>("top", '\0', "find the given number of largest maximal solutions", false, 0);
+	args.add<std::string>("output-format", '\0', "format of the result", false, "text", cmdline::oneof<std::string>("text", "json"));
+	args.add<std::string>("output", 'o', "file the JSON result is written to, stdout if empty", false, "");
+	args.add("server", '\0', "keep the graphs (comma-separated -d) loaded and answer queries from stdin");
+	args.add<std::string>("socket", '\0', "serve queries on this Unix socket instead of stdin", false, "");
 
 	args.parse_check(argc, argv);
 
@@ -24,18 +54,153 @@ int main(int argc, char* argv[]) {
 	auto k = args.get<int>("key");
 	auto algo = args.get<std::string>("algo");
 
+	defclique::Options opt;
+	opt.threads = args.get<int>("threads");
+	opt.restarts = args.get<int>("restarts");
+	opt.lsTime = args.get<long>("ls-time");
+	opt.timeLimit = args.get<long>("time-limit");
+	opt.checkpoint = args.get<std::string>("checkpoint");
+	opt.checkpointInterval = args.get<long>("checkpoint-interval");
+	opt.resume = args.exist("resume");
+	opt.branchStats = args.exist("branch-stats");
+	opt.traceRoots = args.exist("trace-roots");
+	opt.rootCosts = args.get<std::string>("root-costs");
+	opt.rootCostsTop = args.get<int>("root-costs-top");
+	opt.memoryStats = args.exist("memory-stats");
+	opt.vertex = args.get<int>("vertex");
+	opt.relabel = args.exist("relabel");
+
+	if (opt.resume && opt.checkpoint.empty()) {
+		log("--resume requires a checkpoint file (--checkpoint)");
+		return 1;
+	}
+
+	if (opt.vertex >= 0 && ((algo != "MDC" && algo != "RussianDoll") || !opt.checkpoint.empty())) {
+		log("--vertex is only supported by MDC and RussianDoll, without checkpoints");
+		return 1;
+	}
+
+	if (!opt.rootCosts.empty() && ((algo != "MDC" && algo != "RussianDoll") || opt.vertex >= 0)) {
+		log("--root-costs is only supported by MDC and RussianDoll, without --vertex");
+		return 1;
+	}
+
+	bool perf = args.exist("perf-counters");
+
+	if (perf && algo != "MDC" && algo != "RussianDoll") {
+		log("--perf-counters is only supported by MDC and RussianDoll");
+		return 1;
+	}
+
+	bool sweep = args.exist("sweep");
+	auto socketPath = args.get<std::string>("socket");
+	bool serve = args.exist("server") || !socketPath.empty();
+
+	if (!serve && !args.exist("key")) {
+		log("need option: --key");
+		return 1;
+	}
+
+	if (serve && (sweep || opt.resume || !opt.checkpoint.empty())) {
+		log("--server does not support --sweep or checkpoints");
+		return 1;
+	}
+
+	if (sweep && ((algo != "MDC" && algo != "RussianDoll") || !opt.checkpoint.empty())) {
+		log("--sweep is only supported by MDC and RussianDoll, without checkpoints");
+		return 1;
+	}
+
+	progress().enable(args.get<long>("progress"));
+
+	auto tracePath = args.get<std::string>("trace");
+	if (!tracePath.empty()) tracer().enable();
+
+	if (perf) {
+		if (!perfCounters().enable())
+			log("Warning: hardware counters unavailable (%s), running without them", perfCounters().error().c_str())
+		else if (!perfCounters().error().empty())
+			log("Warning: some hardware counters unavailable (%s)", perfCounters().error().c_str())
+	}
+
 	auto startTimePoint = std::chrono::steady_clock::now();
 
-	if (algo == "MDC") defclique::run(dataPath, k, REDUCTION_SEARCH);
-	else if (algo == "RussianDoll") defclique::run(dataPath, k, RUSSIANDOLL_SEARCH);
-	else if (algo == "KDBB") kdbb::run(dataPath, k);
+	auto profilePath = args.get<std::string>("profile");
+
+	if (!profilePath.empty() && (sweep || opt.vertex >= 0 || !opt.checkpoint.empty() || (algo != "MDC" && algo != "RussianDoll"))) {
+		log("--profile is only supported by MDC and RussianDoll, without --sweep, --vertex or checkpoints");
+		return 1;
+	}
+
+	auto enumeratePath = args.get<std::string>("enumerate");
+
+	if (!enumeratePath.empty() && (sweep || opt.vertex >= 0 || !profilePath.empty() || !opt.checkpoint.empty() || (algo != "MDC" && algo != "RussianDoll"))) {
+		log("--enumerate is only supported by MDC and RussianDoll, without --sweep, --vertex, --profile or checkpoints");
+		return 1;
+	}
+
+	int topN = args.get<int>("top");
+
+	if (topN > 0 && (sweep || opt.vertex >= 0 || !profilePath.empty() || !enumeratePath.empty() || !opt.checkpoint.empty() || (algo != "MDC" && algo != "RussianDoll"))) {
+		log("--top is only supported by MDC and RussianDoll, without --sweep, --vertex, --profile, --enumerate or checkpoints");
+		return 1;
+	}
+
+	bool json = args.get<std::string>("output-format") == "json";
+
+	if (json && (serve || topN > 0 || !enumeratePath.empty() || !profilePath.empty() || (algo != "MDC" && algo != "RussianDoll"))) {
+		log("--output-format json is only supported by MDC and RussianDoll, without --server, --top, --enumerate or --profile");
+		return 1;
+	}
+
+	std::vector<defclique::Result> results;
+
+	if (serve) {
+		std::vector<std::string> filenames;
+		size_t begin = 0, end;
+		do {
+			end = dataPath.find(',', begin);
+			filenames.push_back(dataPath.substr(begin, end - begin));
+			begin = end + 1;
+		} while (end != std::string::npos);
+		server::run(filenames, socketPath, opt);
+	}
+	else if (topN > 0) defclique::top(dataPath, k, topN, opt);
+	else if (!enumeratePath.empty()) defclique::enumerate(dataPath, k, args.get<int>("min-size"), enumeratePath, opt);
+	else if (!profilePath.empty()) defclique::profile(dataPath, k, profilePath, opt);
+	else if (sweep) results = defclique::sweep(dataPath, k, algo == "MDC" ? REDUCTION_SEARCH : RUSSIANDOLL_SEARCH, opt);
+	else if (algo == "MDC") results.push_back(defclique::run(dataPath, k, REDUCTION_SEARCH, opt));
+	else if (algo == "RussianDoll") results.push_back(defclique::run(dataPath, k, RUSSIANDOLL_SEARCH, opt));
+	else if (algo == "KDBB") kdbb::run(dataPath, k, opt.timeLimit);
 	else if (algo == "PMC") kdbb::fastLB(dataPath);
 
 	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
 		std::chrono::steady_clock::now() - startTimePoint);
 
 	log("Total time spent: %ld ms", duration.count());
-	
+
+	if (!tracePath.empty()) {
+		if (tracer().write(tracePath)) log("Trace written to %s", tracePath.c_str())
+		else log("Unable to write trace %s", tracePath.c_str());
+	}
+
+	if (json) {
+		auto outputPath = args.get<std::string>("output");
+		FILE *fp = outputPath.empty() ? stdout : fopen(outputPath.c_str(), "w");
+		if (fp == nullptr) {
+			log("Unable to write %s", outputPath.c_str());
+			return 1;
+		}
+		// A sweep gives one record per k
+		if (sweep) fprintf(fp, "[");
+		for (int i = 0; i < results.size(); ++i) {
+			if (i > 0) fprintf(fp, ",\n");
+			defclique::writeJson(fp, dataPath, sweep ? i : k, algo, results[i], sweep ? results[i].stats.sweepTime : duration.count());
+		}
+		fprintf(fp, sweep ? "]\n" : "\n");
+		if (fp != stdout) fclose(fp);
+	}
+
 
 	return 0;
 }
@@ -0,0 +1,213 @@
+#include "server.h"
+#include "../utils/log.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace server {
+	std::vector<Instance> instances;
+	defclique::Options opt;
+}
+
+void server::load(const std::string &filename) {
+	instances.emplace_back();
+	Instance &I = instances.back();
+
+	const char *base = strrchr(filename.c_str(), '/');
+	I.name = base != nullptr ? base+1 : filename;
+
+	log("Loading graph: %s ...", I.name.c_str());
+
+	auto startTimePoint = std::chrono::steady_clock::now();
+
+	I.G.loadFromFile(filename, opt.threads);
+	I.cache.oG.degeneracyOrdering(I.G);
+	I.cache.orderedG = true;
+	I.degS.assign(I.G.n, 0);
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - startTimePoint);
+
+	log("Loading graph done! n=%d, m=%d, Time spent: %ld ms", I.G.V.size(), I.G.m, duration.count());
+}
+
+// A request is a line of key=value tokens:
+//   graph=<name> k=<k> [algo=MDC|RussianDoll] [vertex=<v>] [time=<ms>]
+// With vertex=<v>, the largest solution containing v is searched instead.
+// The answer is a line starting with "ok" or "error", preceded by one
+// "incumbent" line per improvement found while solving.
+std::string server::query(const std::string &request, FILE *out) {
+
+	std::istringstream ss(request);
+	std::string token, graph = instances[0].name, algo = "MDC";
+	long k = -1, vertex = -1, timeLimit = opt.timeLimit;
+
+	while (ss >> token) {
+		size_t eq = token.find('=');
+		if (eq == std::string::npos) return "error malformed token: " + token;
+		std::string key = token.substr(0, eq), value = token.substr(eq+1);
+		if (key == "graph" || key == "algo") {
+			(key == "graph" ? graph : algo) = value;
+			continue;
+		}
+		char *end;
+		long x = strtol(value.c_str(), &end, 10);
+		if (value.empty() || *end != '\0' || x < 0) return "error invalid value: " + token;
+		// k and vertex are passed on as int
+		if (key != "time" && x > INT_MAX) return "error invalid value: " + token;
+		if (key == "k") k = x;
+		else if (key == "vertex") vertex = x;
+		else if (key == "time") timeLimit = x;
+		else return "error unknown key: " + key;
+	}
+
+	if (k < 0) return "error missing k";
+	if (algo != "MDC" && algo != "RussianDoll") return "error unsupported algo: " + algo;
+
+	auto it = std::find_if(instances.begin(), instances.end(), 
+		[&](const Instance &I) { return I.name == graph; });
+	if (it == instances.end()) return "error unknown graph: " + graph;
+
+	Instance &I = *it;
+	defclique::Result res;
+	bool cached = I.optima.count(k) > 0 && (vertex == -1 || I.optima[k].inside(vertex));
+
+	if (vertex >= I.G.n || (vertex != -1 && !I.G.V.inside(vertex))) 
+		return "error unknown vertex: " + std::to_string(vertex);
+
+	defclique::timer.start(timeLimit);
+
+	if (cached) {
+		res.Ss = I.optima[k];
+		res.optimal = true;
+	}
+	else {
+		defclique::onIncumbent = [&](VertexSet &V, const std::string &phase) {
+			fprintf(out, "incumbent size=%d phase=%s time=%ld\n", V.size(), phase.c_str(), defclique::timer.elapsed());
+			fflush(out);
+		};
+
+		if (vertex != -1) res = defclique::solveVertex(I.G, k, vertex, &I.cache.oG);
+		else {
+			// The optimum of a smaller k is a valid initial incumbent, greedily
+			// extended with the edges k allows it to miss, as in a sweep
+			I.cache.Ss.clear();
+			auto lower = I.optima.lower_bound(k);
+			if (lower != I.optima.begin()) {
+				I.cache.Ss = (--lower)->second;
+				defclique::extend(I.G, I.cache.Ss, k, I.degS);
+			}
+
+			defclique::Options o = opt;
+			o.timeLimit = timeLimit;
+
+			res = defclique::solve(I.G, k, algo == "MDC" ? REDUCTION_SEARCH : RUSSIANDOLL_SEARCH, o, &I.cache);
+			if (res.optimal) I.optima[k] = res.Ss;
+		}
+
+		defclique::onIncumbent = nullptr;
+	}
+
+	std::vector<int> S(res.Ss.begin(), res.Ss.end());
+	std::sort(S.begin(), S.end());
+
+	std::stringstream answer;
+	answer << "ok graph=" << I.name << " k=" << k << " algo=" << algo;
+	if (vertex != -1) answer << " vertex=" << vertex;
+	answer << " size=" << S.size() << " optimal=" << (res.optimal ? "yes" : "no") 
+		<< " cached=" << (cached ? "yes" : "no") << " time=" << defclique::timer.elapsed() 
+		<< " vertices=";
+	for (int i = 0; i < S.size(); ++i) {
+		if (i > 0) answer << ",";
+		answer << S[i];
+	}
+	return answer.str();
+}
+
+void server::serve(FILE *in, FILE *out) {
+	char *line = nullptr;
+	size_t capacity = 0;
+	ssize_t length;
+
+	while ((length = getline(&line, &capacity, in)) != -1) {
+		std::string request(line, length);
+		while (!request.empty() && isspace(request.back())) request.pop_back();
+		if (request.empty()) continue;
+		if (request == "quit") break;
+		fprintf(out, "%s\n", query(request, out).c_str());
+		fflush(out);
+	}
+
+	free(line);
+}
+
+void server::listen(const std::string &socketPath) {
+
+	// A client hanging up must not kill the server
+	signal(SIGPIPE, SIG_IGN);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path)-1);
+	unlink(socketPath.c_str());
+
+	if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd, 16) < 0) {
+		log("Error: unable to listen on %s: %s", socketPath.c_str(), strerror(errno));
+		if (fd >= 0) close(fd);
+		return;
+	}
+
+	log("Listening on %s ...", socketPath.c_str());
+
+	// Queries share the solver state, so clients are served one at a time
+	while (true) {
+		int conn = accept(fd, nullptr, nullptr);
+		if (conn < 0) {
+			if (errno == EINTR) continue;
+			log("Error: accept failed: %s", strerror(errno));
+			break;
+		}
+		FILE *in = fdopen(conn, "r");
+		if (in == nullptr) {
+			log("Error: unable to read the connection: %s", strerror(errno));
+			close(conn);
+			continue;
+		}
+		int copy = dup(conn);
+		FILE *out = copy >= 0 ? fdopen(copy, "w") : nullptr;
+		if (out == nullptr) {
+			log("Error: unable to write the connection: %s", strerror(errno));
+			if (copy >= 0) close(copy);
+			fclose(in);
+			continue;
+		}
+		serve(in, out);
+		fclose(in);
+		fclose(out);
+	}
+
+	close(fd);
+	unlink(socketPath.c_str());
+}
+
+void server::run(const std::vector<std::string> &filenames, const std::string &socketPath, 
+	const defclique::Options &opt) {
+
+	server::opt = opt;
+
+	instances.reserve(filenames.size());
+	for (auto &filename : filenames) load(filename);
+
+	if (socketPath.empty()) serve(stdin, stdout);
+	else listen(socketPath);
+}
@@ -0,0 +1,32 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#pragma once
+
+#include "../defclique/defclique.h"
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace server {
+
+	// A graph kept in memory between queries, with its orderings, last
+	// reduced core and the optima already proven for it
+	struct Instance {
+		std::string name;
+		Graph G;
+		defclique::Cache cache;
+		std::map<int, VertexSet> optima;	// by k, the same for every algorithm
+		std::vector<int> degS;	// zeroed buffer of defclique::extend
+	};
+
+	void load(const std::string &filename);
+	std::string query(const std::string &request, FILE *out);
+	void serve(FILE *in, FILE *out);
+	void listen(const std::string &socketPath);
+	void run(const std::vector<std::string> &filenames, const std::string &socketPath, 
+		const defclique::Options &opt);
+}
+
+#endif // SERVER_H
@@ -33,11 +33,19 @@ public:
 		vis.resize(newCapacity, false);
 	}
 
+	// Heap bytes held by the colouring and its ordering
+	size_t memory() const {
+		size_t res = color.capacity() * sizeof(int) + vis.capacity() / 8 + bin.capacity() * sizeof(bin[0]) + o.memory();
+		for (auto &b : bin) res += b.capacity() * sizeof(int);
+		return res;
+	}
+
 	void graphColoring(Graph &G, int tau) {
 		if (tau < 0) tau = 0;
 
 		if (tau > bin.size()) bin.resize(tau);
 
+		numColors = 0;
 		int n = 0;
 
 		for (int v : G.V) {
@@ -7,15 +7,29 @@
 #include <unordered_map>
 #include <vector>
 #include <algorithm>
+#include <utility>
 #include "hash.hpp"
 #include "fastio.hpp"
 #include "vertexset.hpp"
 
+// Adjacency tables of Graph. WideCuckooHash takes less memory and does not
+// degrade on ids sharing their low bits, CuckooHash answers queries on
+// cached tables slightly faster; see bin/microbench
+//#define WIDE_HASH
+#ifdef WIDE_HASH
+typedef WideCuckooHash AdjacencyHash;
+#else
+typedef CuckooHash AdjacencyHash;
+#endif
+
 struct Graph {
 	int n, m, maxDeg, capacity;
-	std::vector<CuckooHash> nbrMap;
+	std::vector<AdjacencyHash> nbrMap;
 	std::vector<std::vector<int>> nbr;
 	VertexSet V;
+	// Hash tables of another graph answering connect instead of nbrMap,
+	// not owned; see shareAdjacency
+	const std::vector<AdjacencyHash> *sharedMap = nullptr;
 
 	Graph() {
 		n = m = maxDeg = capacity = 0;
@@ -26,13 +40,14 @@ struct Graph {
 		resize(n);
 	}
 
-	Graph(const std::string& dataset) {
-		loadFromFile(dataset);
+	Graph(const std::string& dataset, int threads = 1) {
+		loadFromFile(dataset, threads);
 	}
 
 	void clear() {
 		std::vector<std::vector<int>>().swap(nbr);
-		std::vector<CuckooHash>().swap(nbrMap);
+		std::vector<AdjacencyHash>().swap(nbrMap);
+		sharedMap = nullptr;
 		V.clear();
 		n = m = maxDeg = capacity = 0;
 	}
@@ -40,22 +55,114 @@ struct Graph {
 	void resize(int size) {
 		capacity = size;
 		nbr.resize(size);
-		nbrMap.resize(size);
+		if (sharedMap == nullptr) nbrMap.resize(size);
 		V.reserve(size);
 	}
 
-	void loadFromFile(const std::string& filename) {
-		clear();
+	void loadFromFile(const std::string& filename, int threads = 1) {
 		FastIO fio(filename, "r");
-		n = fio.getUInt();
+		int size = fio.getUInt();
 		int numEdges = fio.getUInt();
+		std::vector<std::pair<int, int>> edges(numEdges);
+		for (auto &e : edges) {
+			e.first = fio.getUInt();
+			e.second = fio.getUInt();
+		}
+		build(size, edges, threads);
+	}
+
+	// Builds the graph from all its edges at once, as if they were added
+	// with addEdge in this order: duplicates are dropped and neighbour lists
+	// keep the order of first appearance. Every list and hash table is sized
+	// exactly once and filled without the probes and rehashes of adding the
+	// edges one by one, in parallel over the vertices. Each of the threads
+	// holds two arrays of n ints.
+	void build(int size, const std::vector<std::pair<int, int>> &edges, int threads = 1) {
+		clear();
+		n = size;
+		for (auto &e : edges) n = std::max(n, std::max(e.first, e.second) + 1);
+		resize(n);
+		for (auto &e : edges) {
+			V.push(e.first);
+			V.push(e.second);
+		}
+
+		// Neighbours grouped by vertex in the order of the edges, with the
+		// index of their edge
+		int numEdges = edges.size();
+		std::vector<long long> offset(n + 1, 0);
+		for (auto &e : edges) {
+			++offset[e.first + 1];
+			++offset[e.second + 1];
+		}
+		for (int u = 0; u < n; ++u) offset[u + 1] += offset[u];
+		std::vector<int> adj(offset[n]), eid(offset[n]);
+		{
+			std::vector<long long> pos(offset.begin(), offset.end() - 1);
+			for (int i = 0; i < numEdges; ++i) {
+				int u = edges[i].first, v = edges[i].second;
+				adj[pos[u]] = v;
+				eid[pos[u]++] = i;
+				adj[pos[v]] = u;
+				eid[pos[v]++] = i;
+			}
+		}
+
+		// A neighbour is kept at its first edge, which is then the first
+		// appearance of the edge at both ends; a self-loop appears twice
+		long long numEntries = 0;
+		int maxDegree = 0;
+		#pragma omp parallel num_threads(threads) reduction(+: numEntries) reduction(max: maxDegree)
+		{
+			std::vector<int> seen(n, -1), first(n);
+			#pragma omp for schedule(dynamic, 1024)
+			for (int u = 0; u < n; ++u) {
+				int deg = 0;
+				for (long long j = offset[u]; j < offset[u + 1]; ++j) {
+					int v = adj[j];
+					if (seen[v] != u) {
+						seen[v] = u;
+						first[v] = eid[j];
+					}
+					else if (eid[j] != first[v]) continue;
+					adj[offset[u] + deg++] = v;
+				}
+				if (deg == 0) continue;
+				nbr[u].assign(adj.begin() + offset[u], adj.begin() + offset[u] + deg);
+				nbrMap[u].reserve(deg);
+				for (int v : nbr[u]) nbrMap[u].insert(v);
+				numEntries += deg;
+				maxDegree = std::max(maxDegree, deg);
+			}
+		}
+		m = numEntries / 2;
+		maxDeg = maxDegree;
+	}
+
+	// Copy of G with every vertex u renamed id[u], which must be one-to-one.
+	// Neighbour lists keep their order, and V lists the vertices by new id.
+	void relabel(const Graph &G, const std::vector<int> &id, int threads = 1) {
+		clear();
+		n = G.n;
+		for (int u : G.V) n = std::max(n, id[u] + 1);
 		resize(n);
-		for (int i = 0; i < numEdges; ++i) {
-			// fprintf(stderr, "%u/%u\r", i, numEdges);
-			int u = fio.getUInt();
-			int v = fio.getUInt();
-			addEdge(u, v);
+		std::vector<int> vertices;
+		vertices.reserve(G.V.size());
+		for (int u : G.V) vertices.push_back(id[u]);
+		std::sort(vertices.begin(), vertices.end());
+		for (int u : vertices) V.push(u);
+		#pragma omp parallel for num_threads(threads) schedule(dynamic, 1024)
+		for (int i = 0; i < G.V.size(); ++i) {
+			int u = G.V.begin()[i];
+			if (G.nbr[u].empty()) continue;
+			std::vector<int> &l = nbr[id[u]];
+			l.reserve(G.nbr[u].size());
+			for (int v : G.nbr[u]) l.push_back(id[v]);
+			nbrMap[id[u]].reserve(l.size());
+			for (int v : l) nbrMap[id[u]].insert(v);
 		}
+		m = G.m;
+		maxDeg = G.maxDeg;
 	}
 
 	void addEdge(int u, int v) {
@@ -75,7 +182,53 @@ struct Graph {
 	}
 
 	bool connect(int u, int v) const {
-		return nbrMap[u].find(v);
+		return (sharedMap != nullptr ? (*sharedMap)[u] : nbrMap[u]).find(v);
+	}
+
+	// Bit i tells whether u and w[i] are adjacent, for up to 64 vertices;
+	// cheaper than as many calls to connect
+	uint64_t connectMask(int u, const int *w, int cnt) const {
+		return (sharedMap != nullptr ? (*sharedMap)[u] : nbrMap[u]).findMask(w, cnt);
+	}
+
+	// Answers connect with the hash tables of G instead of a copy of them,
+	// for sub-graphs that only build nbr, e.g. with subGraph. G must outlive
+	// this graph, and its edges must include those of this graph.
+	void shareAdjacency(const Graph &G) {
+		std::vector<AdjacencyHash>().swap(nbrMap);
+		sharedMap = G.sharedMap != nullptr ? G.sharedMap : &G.nbrMap;
+	}
+
+	// Heap bytes held by the neighbour lists
+	size_t nbrMemory() const {
+		size_t res = nbr.capacity() * sizeof(nbr[0]);
+		for (auto &l : nbr) res += l.capacity() * sizeof(int);
+		return res;
+	}
+
+	// Heap bytes held by the neighbour hash tables
+	size_t nbrMapMemory() const {
+		size_t res = nbrMap.capacity() * sizeof(AdjacencyHash);
+		for (auto &h : nbrMap) res += h.memory();
+		return res;
+	}
+
+	size_t memory() const {
+		return nbrMemory() + nbrMapMemory() + V.memory();
+	}
+
+	// Hash of the edge set, independent of the order edges were added in
+	uint64_t fingerprint() const {
+		uint64_t h = n;
+		for (int u : V)
+			for (int v : nbr[u])
+				if (u < v) {
+					uint64_t x = ((uint64_t)u << 32 | v) + 0x9e3779b97f4a7c15ull;
+					x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+					x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+					h += x ^ (x >> 31);
+				}
+		return h;
 	}
 
 	void addVertices(const VertexSet& S) {
@@ -117,9 +270,13 @@ struct Graph {
 
 		for (int u : V) {
 			if (V.size() < G.nbr[u].size()) {
-				for (int v : V)
-					if (u  < v && G.connect(u, v))
-						add_edge(u, v);
+				for (const int *w = V.begin(); w < V.end(); w += 64) {
+					int cnt = std::min(64, (int)(V.end() - w));
+					for (uint64_t adj = G.connectMask(u, w, cnt); adj; adj &= adj-1) {
+						int v = w[__builtin_ctzll(adj)];
+						if (u < v) add_edge(u, v);
+					}
+				}
 			}
 			else {
 				for (int v : G.nbr[u])
@@ -7,10 +7,15 @@
 #include <algorithm>
 #include <stdio.h>
 #include <vector>
+#include <cstdlib>
+#include <new>
 #include <emmintrin.h>
+#include <immintrin.h>
 
 constexpr int unfilled = -1;
 constexpr int buff_size = sizeof(int);
+constexpr int prefetch_distance = 8;	// keys ahead whose buckets a batched query prefetches
+constexpr int prefetch_capacity = 4096;	// slots above which a table is not assumed to be in L1
 
 class CuckooHash {
 private:
@@ -191,6 +196,28 @@ public:
 
 		return _mm_movemask_epi8(flag) != 0;
 	}
+
+	// Bit i tells whether w[i] is in the set, for up to 64 keys
+	uint64_t findMask(const int *w, int cnt) const {
+		if (size == 0) return 0;
+		const int* hashtable_ptr = hashtable.data();
+		bool prefetch = capacity > prefetch_capacity;
+		uint64_t res = 0;
+		for (int i = 0; i < cnt; ++i) {
+			if (prefetch && i + prefetch_distance < cnt) {
+				int x = w[i + prefetch_distance];
+				_mm_prefetch((const char*)&hashtable_ptr[buff_size * hash1(x)], _MM_HINT_T0);
+				_mm_prefetch((const char*)&hashtable_ptr[buff_size * hash2(x)], _MM_HINT_T0);
+			}
+			__m128i cmp = _mm_set1_epi32(w[i]);
+			__m128i b1 = _mm_load_si128((__m128i*)&hashtable_ptr[buff_size * hash1(w[i])]);
+			__m128i b2 = _mm_load_si128((__m128i*)&hashtable_ptr[buff_size * hash2(w[i])]);
+			__m128i flag = _mm_or_si128(_mm_cmpeq_epi32(cmp, b1), _mm_cmpeq_epi32(cmp, b2));
+			res |= (uint64_t)(_mm_movemask_epi8(flag) != 0) << i;
+		}
+		return res;
+	}
+
 	void erase(int u) {
 		if (size == 0) return;
 		int hs1 = hash1(u);
@@ -213,6 +240,7 @@ public:
 		}
 	}
 	int getcapacity() {return capacity;}
+	size_t memory() const {return hashtable.capacity() * sizeof(int);}	// heap bytes
 	int getsize() {return size;}
 	int getmask() {return mask;}
 
@@ -223,4 +251,223 @@ public:
 	}
 };
 
+// Allocator of buffers aligned to a cache line, so that no bucket of a
+// WideCuckooHash straddles two lines
+template<typename T>
+struct CacheAlignedAllocator {
+	typedef T value_type;
+	template<typename U> struct rebind { typedef CacheAlignedAllocator<U> other; };
+
+	CacheAlignedAllocator() {}
+	template<typename U> CacheAlignedAllocator(const CacheAlignedAllocator<U> &) {}
+
+	T *allocate(size_t n) {
+		void *p = nullptr;
+		if (posix_memalign(&p, 64, std::max(n, (size_t)1) * sizeof(T)) != 0) throw std::bad_alloc();
+		return (T *)p;
+	}
+	void deallocate(T *p, size_t) { free(p); }
+
+	template<typename U> bool operator==(const CacheAlignedAllocator<U> &) const { return true; }
+	template<typename U> bool operator!=(const CacheAlignedAllocator<U> &) const { return false; }
+};
+
+// Whether the CPU running the binary has AVX2, checked once
+inline bool cpuHasAVX2() {
+	static const bool res = []() {
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") != 0;
+	}();
+	return res;
+}
+
+constexpr int wide_buff_size = 8;
+
+// Cuckoo hash set with 8-slot buckets, i.e. a bucket is one 32-byte AVX2
+// register, and multiply-shift hashing, so that ids sharing their low bits
+// do not pile up in the same buckets. find compares both buckets of a key
+// with AVX2 when the CPU has it, with SSE2 otherwise; the choice is made at
+// compile time with -mavx2 or -march=native, else once at run time.
+class WideCuckooHash {
+private:
+	int capacity;
+	int bits;		// log2 of the number of buckets
+	int size;
+	std::vector<int, CacheAlignedAllocator<int>> hashtable;
+
+	static const uint32_t seed1 = 0x9E3779B1u, seed2 = 0x85EBCA77u;
+	static const int max_kicks = 128;
+
+	// Top bits of the product, 0 with a single bucket
+	int bucket(int x, uint32_t seed) const {
+		return (int)((uint64_t)((uint32_t)x * seed) >> (32 - bits));
+	}
+	int hash1(int x) const { return bucket(x, seed1); }
+	int hash2(int x) const { return bucket(x, seed2); }
+
+	// Slots a table of 2^bits buckets may fill before growing
+	static int maxLoad(int bits) {
+		return bits == 0 ? wide_buff_size : (wide_buff_size - 1) << bits;
+	}
+
+	bool place(int *table, int b, int u) {
+		for (int i = 0; i < wide_buff_size; ++i)
+			if (table[b * wide_buff_size + i] == unfilled) {
+				table[b * wide_buff_size + i] = u;
+				return true;
+			}
+		return false;
+	}
+
+	// Inserts u by displacing keys to their other bucket, false with the
+	// homeless key left in u if the walk is too long
+	bool insert(int &u, int *table) {
+		int b = hash1(u);
+		if (place(table, b, u) || place(table, b = hash2(u), u)) return true;
+		for (int i = 0; i < max_kicks; ++i) {
+			int &slot = table[b * wide_buff_size + (i + b) % wide_buff_size];
+			std::swap(u, slot);
+			int b1 = hash1(u);
+			b = b == b1 ? hash2(u) : b1;
+			if (place(table, b, u)) return true;
+		}
+		return false;
+	}
+
+	void rehash(int newbits, int pending) {
+		std::vector<int, CacheAlignedAllocator<int>> old;
+		old.swap(hashtable);
+		for (;;) {
+			bits = newbits;
+			capacity = wide_buff_size << bits;
+			hashtable.assign(capacity, unfilled);
+			bool ok = true;
+			for (int i = 0; i < old.size() && ok; ++i) {
+				int v = old[i];
+				if (v != unfilled) ok = insert(v, hashtable.data());
+			}
+			int v = pending;
+			if (ok && (v == unfilled || insert(v, hashtable.data()))) return;
+			++newbits;
+		}
+	}
+
+	__attribute__((target("avx2")))
+	bool findAVX2(int u) const {
+		const int* hashtable_ptr = hashtable.data();
+		__m256i cmp = _mm256_set1_epi32(u);
+		__m256i b1 = _mm256_load_si256((const __m256i*)&hashtable_ptr[wide_buff_size * hash1(u)]);
+		__m256i b2 = _mm256_load_si256((const __m256i*)&hashtable_ptr[wide_buff_size * hash2(u)]);
+		__m256i flag = _mm256_or_si256(_mm256_cmpeq_epi32(cmp, b1), _mm256_cmpeq_epi32(cmp, b2));
+		return !_mm256_testz_si256(flag, flag);
+	}
+
+	bool findSSE2(int u) const {
+		const int* b1 = &hashtable.data()[wide_buff_size * hash1(u)];
+		const int* b2 = &hashtable.data()[wide_buff_size * hash2(u)];
+		__m128i cmp = _mm_set1_epi32(u);
+		__m128i flag = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi32(cmp, _mm_load_si128((const __m128i*)b1)),
+				_mm_cmpeq_epi32(cmp, _mm_load_si128((const __m128i*)(b1 + 4)))),
+			_mm_or_si128(_mm_cmpeq_epi32(cmp, _mm_load_si128((const __m128i*)b2)),
+				_mm_cmpeq_epi32(cmp, _mm_load_si128((const __m128i*)(b2 + 4)))));
+		return _mm_movemask_epi8(flag) != 0;
+	}
+
+	void prefetchBuckets(const int *w, int i, int cnt) const {
+		if (i + prefetch_distance >= cnt) return;
+		int x = w[i + prefetch_distance];
+		_mm_prefetch((const char*)&hashtable.data()[wide_buff_size * hash1(x)], _MM_HINT_T0);
+		_mm_prefetch((const char*)&hashtable.data()[wide_buff_size * hash2(x)], _MM_HINT_T0);
+	}
+
+	__attribute__((target("avx2")))
+	uint64_t findMaskAVX2(const int *w, int cnt) const {
+		bool prefetch = capacity > prefetch_capacity;
+		uint64_t res = 0;
+		for (int i = 0; i < cnt; ++i) {
+			if (prefetch) prefetchBuckets(w, i, cnt);
+			res |= (uint64_t)findAVX2(w[i]) << i;
+		}
+		return res;
+	}
+
+	uint64_t findMaskSSE2(const int *w, int cnt) const {
+		bool prefetch = capacity > prefetch_capacity;
+		uint64_t res = 0;
+		for (int i = 0; i < cnt; ++i) {
+			if (prefetch) prefetchBuckets(w, i, cnt);
+			res |= (uint64_t)findSSE2(w[i]) << i;
+		}
+		return res;
+	}
+
+public:
+	WideCuckooHash() {
+		clear();
+	}
+	void clear() {
+		capacity = bits = size = 0;
+	}
+
+	void reserve(int size) {
+		if (capacity > 0 && maxLoad(bits) >= size) return;
+		int newbits = 0;
+		while (maxLoad(newbits) < size) ++newbits;
+		if (capacity == 0) {
+			bits = newbits;
+			capacity = wide_buff_size << bits;
+			hashtable.assign(capacity, unfilled);
+		}
+		else rehash(newbits, unfilled);
+	}
+
+	void insert(int u) {
+		if (find(u)) return;
+		if (capacity == 0) reserve(1);
+		if (size == maxLoad(bits)) rehash(bits + 1, u);
+		else if (!insert(u, hashtable.data())) rehash(bits + 1, u);
+		size++;
+	}
+
+	bool find(int u) const {
+		if (size == 0) return false;
+#ifdef __AVX2__
+		return findAVX2(u);
+#else
+		return cpuHasAVX2() ? findAVX2(u) : findSSE2(u);
+#endif
+	}
+
+	// Bit i tells whether w[i] is in the set, for up to 64 keys
+	uint64_t findMask(const int *w, int cnt) const {
+		if (size == 0) return 0;
+#ifdef __AVX2__
+		return findMaskAVX2(w, cnt);
+#else
+		return cpuHasAVX2() ? findMaskAVX2(w, cnt) : findMaskSSE2(w, cnt);
+#endif
+	}
+
+	void erase(int u) {
+		if (size == 0) return;
+		int hs[2] = {hash1(u), hash2(u)};
+		for (int b : hs)
+			for (int i = 0; i < wide_buff_size; ++i)
+				if (hashtable[b * wide_buff_size + i] == u) {
+					hashtable[b * wide_buff_size + i] = unfilled;
+					size--;
+					return;
+				}
+	}
+
+	int getcapacity() {return capacity;}
+	size_t memory() const {return hashtable.capacity() * sizeof(int);}	// heap bytes
+	int getsize() {return size;}
+
+	bool operator[](const int &u) const {
+		return find(u);
+	}
+};
+
 #endif	
\ No newline at end of file
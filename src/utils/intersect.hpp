@@ -0,0 +1,153 @@
+#ifndef INTERSECT_HPP
+#define INTERSECT_HPP
+
+#pragma once
+
+#include "graph.hpp"
+#include "hash.hpp"		// cpuHasAVX2
+#include <algorithm>
+#include <vector>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+// Intersection of two lists sorted by id and without duplicates, e.g. the
+// lists of sortedAdjacency. Each kernel returns the number of common
+// ids and, with List, also writes them in order to out, which must hold the
+// shorter list. intersectCount and intersect pick the kernel from the sizes.
+// While the hash tables of the graph stay in cache, probing the table of one
+// end for each id of the shorter list is faster still, so the reductions and
+// the search keep doing that; see the common neighbour lines of microbench.
+
+#define GALLOP_RATIO 32		// size ratio above which the shorter list gallops over the longer one
+#define BLOCK_MIN_SIZE 16	// size of the shorter list below which the scalar merge is used
+
+// Branch-free merge, best for short lists of similar sizes
+template<bool List>
+inline int intersectMerge(const int *a, int na, const int *b, int nb, int *out) {
+	int i = 0, j = 0, cnt = 0;
+	while (i < na && j < nb) {
+		int x = a[i], y = b[j];
+		if (List) out[cnt] = x;
+		cnt += x == y;
+		i += x <= y;
+		j += y <= x;
+	}
+	return cnt;
+}
+
+// Exponential then binary search of each id of a in b, for |a| << |b|
+template<bool List>
+inline int intersectGallop(const int *a, int na, const int *b, int nb, int *out) {
+	int j = 0, cnt = 0;
+	for (int i = 0; i < na && j < nb; ++i) {
+		int x = a[i], step = 1;
+		while (j + step < nb && b[j + step] < x) {
+			j += step;
+			step <<= 1;
+		}
+		j = std::lower_bound(b + j, b + std::min(j + step + 1, nb), x) - b;
+		if (j < nb && b[j] == x) {
+			if (List) out[cnt] = x;
+			++cnt;
+			++j;
+		}
+	}
+	return cnt;
+}
+
+// Compares blocks of 4 ids of a and b all against all, and moves past the
+// block with the smaller last id; the tails are merged
+template<bool List>
+inline int intersectSSE(const int *a, int na, const int *b, int nb, int *out) {
+	int i = 0, j = 0, cnt = 0;
+	while (i + 4 <= na && j + 4 <= nb) {
+		__m128i va = _mm_loadu_si128((const __m128i*)&a[i]);
+		__m128i vb = _mm_loadu_si128((const __m128i*)&b[j]);
+		__m128i flag = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0,3,2,1)))),
+			_mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1,0,3,2))),
+				_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2,1,0,3)))));
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(flag));
+		if (List)
+			for (; mask; mask &= mask-1) out[cnt++] = a[i + __builtin_ctz(mask)];
+		else
+			cnt += __builtin_popcount(mask);
+		int x = a[i+3], y = b[j+3];
+		i += (x <= y) * 4;
+		j += (y <= x) * 4;
+	}
+	return cnt + intersectMerge<List>(a + i, na - i, b + j, nb - j, out + cnt);
+}
+
+// Same with blocks of 8 ids
+template<bool List>
+__attribute__((target("avx2")))
+inline int intersectAVX2(const int *a, int na, const int *b, int nb, int *out) {
+	int i = 0, j = 0, cnt = 0;
+	while (i + 8 <= na && j + 8 <= nb) {
+		__m256i va = _mm256_loadu_si256((const __m256i*)&a[i]);
+		__m256i vb = _mm256_loadu_si256((const __m256i*)&b[j]);
+		__m256i vs = _mm256_permute2x128_si256(vb, vb, 1);	// halves swapped
+		__m256i flag = _mm256_or_si256(
+			_mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi32(va, vb), _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(0,3,2,1)))),
+				_mm256_or_si256(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(1,0,3,2))),
+					_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(2,1,0,3))))),
+			_mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi32(va, vs), _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(0,3,2,1)))),
+				_mm256_or_si256(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(1,0,3,2))),
+					_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(2,1,0,3))))));
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(flag));
+		if (List)
+			for (; mask; mask &= mask-1) out[cnt++] = a[i + __builtin_ctz(mask)];
+		else
+			cnt += __builtin_popcount(mask);
+		int x = a[i+7], y = b[j+7];
+		i += (x <= y) * 8;
+		j += (y <= x) * 8;
+	}
+	return cnt + intersectSSE<List>(a + i, na - i, b + j, nb - j, out + cnt);
+}
+
+template<bool List>
+inline int intersectAuto(const int *a, int na, const int *b, int nb, int *out) {
+	if (na > nb) {
+		std::swap(a, b);
+		std::swap(na, nb);
+	}
+	if (na == 0) return 0;
+	if ((long long)na * GALLOP_RATIO < nb) return intersectGallop<List>(a, na, b, nb, out);
+	if (na < BLOCK_MIN_SIZE) return intersectMerge<List>(a, na, b, nb, out);
+#ifdef __AVX2__
+	return intersectAVX2<List>(a, na, b, nb, out);
+#else
+	return cpuHasAVX2() ? intersectAVX2<List>(a, na, b, nb, out) : intersectSSE<List>(a, na, b, nb, out);
+#endif
+}
+
+inline int intersectCount(const int *a, int na, const int *b, int nb) {
+	return intersectAuto<false>(a, na, b, nb, nullptr);
+}
+
+inline int intersect(const int *a, int na, const int *b, int nb, int *out) {
+	return intersectAuto<true>(a, na, b, nb, out);
+}
+
+// Neighbour lists of G sorted by id and without self-loops, one after the
+// other: those of u are adj[offset[u]..offset[u+1]). G.nbr keeps its order,
+// which the search depends on.
+inline void sortedAdjacency(const Graph &G, std::vector<long long> &offset, std::vector<int> &adj) {
+	offset.assign(G.n + 1, 0);
+	adj.clear();
+	adj.reserve((size_t)G.m * 2);
+	for (int u = 0; u < G.n; ++u) {
+		offset[u] = adj.size();
+		if (!G.V.inside(u)) continue;
+		for (int v : G.nbr[u])
+			if (v != u) adj.push_back(v);
+		std::sort(adj.begin() + offset[u], adj.end());
+	}
+	offset[G.n] = adj.size();
+}
+
+#endif // INTERSECT_HPP
@@ -160,6 +160,11 @@ public:
 		return keys.size() - ptr;
 	}
 
+	// Heap bytes held by the heap
+	size_t memory() const {
+		return (rank.capacity() + pos.capacity() + bin.capacity() + keys.capacity() + vals.capacity()) * sizeof(int);
+	}
+
 	int operator[] (int k) {
 		return vals[k];
 	}
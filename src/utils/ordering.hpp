@@ -28,6 +28,10 @@ public:
 		ordered.resize(size);
 		value.resize(size);
 	}
+	// Heap bytes held by the ordering and its heap
+	size_t memory() const {
+		return (order.capacity() + ordered.capacity() + value.capacity()) * sizeof(int) + vHeap.memory();
+	}
 	void degeneracyOrdering(Graph &G) {
 		if (capacity < G.n) resize(G.n);
 		vHeap.build(G.V, [&](int v) { return (int)G.nbr[v].size(); });
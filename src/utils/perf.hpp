@@ -0,0 +1,172 @@
+#ifndef PERF_HPP
+#define PERF_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_LLC_MISSES 2
+#define PERF_BRANCH_MISSES 3
+#define NUM_PERF_EVENTS 4
+
+// Hardware counter values, -1 for the events that are not counted
+struct PerfSample {
+	long long value[NUM_PERF_EVENTS];
+
+	PerfSample() {
+		for (int e = 0; e < NUM_PERF_EVENTS; ++e) value[e] = -1;
+	}
+
+	bool empty() const {
+		for (int e = 0; e < NUM_PERF_EVENTS; ++e)
+			if (value[e] >= 0) return false;
+		return true;
+	}
+
+	// Adds the events counted between begin and end
+	void add(const PerfSample &begin, const PerfSample &end) {
+		for (int e = 0; e < NUM_PERF_EVENTS; ++e)
+			if (begin.value[e] >= 0 && end.value[e] >= 0)
+				value[e] = std::max(value[e], 0ll) + end.value[e] - begin.value[e];
+	}
+
+	std::string toString() const {
+		static const char *names[NUM_PERF_EVENTS] = {"cycles", "instructions", "LLC misses", "branch misses"};
+		std::string res;
+		char buf[64];
+		for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+			if (value[e] < 0) snprintf(buf, sizeof(buf), "%s%s=n/a", e > 0 ? ", " : "", names[e]);
+			else snprintf(buf, sizeof(buf), "%s%s=%lld", e > 0 ? ", " : "", names[e], value[e]);
+			res += buf;
+			if (e == PERF_INSTRUCTIONS && value[PERF_CYCLES] > 0 && value[PERF_INSTRUCTIONS] >= 0) {
+				snprintf(buf, sizeof(buf), ", IPC=%.2f", (double)value[PERF_INSTRUCTIONS] / value[PERF_CYCLES]);
+				res += buf;
+			}
+		}
+		return res;
+	}
+};
+
+// Hardware counters of the thread that enabled them, read through
+// perf_event_open as a single group. Counting is off unless enabled, and
+// enable fails gracefully when the kernel or the machine has no counters,
+// e.g. in containers, VMs or with a restrictive perf_event_paranoid.
+class PerfCounters {
+	int fd[NUM_PERF_EVENTS];
+	uint64_t id[NUM_PERF_EVENTS];
+	int leader = -1;
+	std::string reason;
+
+public:
+	PerfCounters() {
+		for (int e = 0; e < NUM_PERF_EVENTS; ++e) fd[e] = -1;
+	}
+
+	PerfCounters(const PerfCounters &) = delete;
+	PerfCounters &operator=(const PerfCounters &) = delete;
+
+	~PerfCounters() {
+#ifdef __linux__
+		for (int e = 0; e < NUM_PERF_EVENTS; ++e)
+			if (fd[e] >= 0) close(fd[e]);
+#endif
+	}
+
+	// Opens the events that are available, false if none is
+	bool enable() {
+#ifdef __linux__
+		static const uint64_t config[NUM_PERF_EVENTS] = {
+			PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+		};
+		for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+			if (fd[e] >= 0) continue;
+			struct perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = config[e];
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+				PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			fd[e] = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+			if (fd[e] < 0) {
+				if (reason.empty()) reason = strerror(errno);
+				continue;
+			}
+			if (ioctl(fd[e], PERF_EVENT_IOC_ID, &id[e]) < 0) {
+				close(fd[e]);
+				fd[e] = -1;
+				continue;
+			}
+			if (leader < 0) leader = fd[e];
+		}
+#else
+		reason = "not supported on this platform";
+#endif
+		return active();
+	}
+
+	bool active() const {
+		return leader >= 0;
+	}
+
+	// Why some events could not be opened, empty if all were
+	const std::string &error() const {
+		return reason;
+	}
+
+	// Current values, scaled up when the events were multiplexed
+	PerfSample read() const {
+		PerfSample s;
+#ifdef __linux__
+		if (!active()) return s;
+		uint64_t buf[3 + 2 * NUM_PERF_EVENTS];
+		if (::read(leader, buf, sizeof(buf)) < 0) return s;
+		uint64_t nr = buf[0], enabled = buf[1], running = buf[2];
+		double scale = running > 0 && running < enabled ? (double)enabled / running : 1.0;
+		for (uint64_t i = 0; i < nr && i < NUM_PERF_EVENTS; ++i)
+			for (int e = 0; e < NUM_PERF_EVENTS; ++e)
+				if (fd[e] >= 0 && id[e] == buf[4 + 2*i])
+					s.value[e] = (long long)(buf[3 + 2*i] * scale);
+#endif
+		return s;
+	}
+};
+
+inline PerfCounters &perfCounters() {
+	static PerfCounters c;
+	return c;
+}
+
+// Adds the events counted during the lifetime of the enclosing scope to total
+class PerfScope {
+	PerfSample &total;
+	PerfSample begin;
+	bool on;
+public:
+	PerfScope(PerfSample &total): total(total), on(perfCounters().active()) {
+		if (on) begin = perfCounters().read();
+	}
+
+	~PerfScope() {
+		if (on) total.add(begin, perfCounters().read());
+	}
+};
+
+#endif // PERF_HPP
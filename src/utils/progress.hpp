@@ -0,0 +1,141 @@
+#ifndef PROGRESS_HPP
+#define PROGRESS_HPP
+
+#pragma once
+
+#include "log.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Periodic progress line of a long search, printed by a side thread so that
+// the search only publishes its counters now and then with relaxed stores.
+// The search also publishes the estimated fraction of the work done, from
+// which the remaining time is extrapolated.
+class Progress {
+	typedef std::chrono::steady_clock Clock;
+
+	long interval = 0;	// ms between two lines, 0 to disable
+	bool on = false;
+	std::atomic<long long> nodes;
+	std::atomic<int> incumbent, rootsDone;
+	std::atomic<double> fraction;
+	int numRoots = 0;
+	std::string label;
+
+	std::thread worker;
+	std::mutex mtx;
+	std::condition_variable cv;
+	bool running = false;
+
+	Clock::time_point startTimePoint, lastTimePoint;
+	long long lastNodes = 0;
+
+	static std::string formatSeconds(double s) {
+		char buf[32];
+		if (s < 10) snprintf(buf, sizeof(buf), "%.1f s", s);
+		else if (s < 120) snprintf(buf, sizeof(buf), "%.0f s", s);
+		else if (s < 7200) snprintf(buf, sizeof(buf), "%.0f min", s / 60);
+		else if (s < 172800) snprintf(buf, sizeof(buf), "%.1f h", s / 3600);
+		else snprintf(buf, sizeof(buf), "%.1f d", s / 86400);
+		return buf;
+	}
+
+	void report() {
+		auto now = Clock::now();
+		double elapsed = std::chrono::duration<double>(now - startTimePoint).count();
+		double dt = std::chrono::duration<double>(now - lastTimePoint).count();
+		long long n = nodes.load(std::memory_order_relaxed);
+		double rate = dt > 0 ? (n - lastNodes) / dt : 0;
+		double f = fraction.load(std::memory_order_relaxed);
+		std::string eta = f > 0 ? formatSeconds(elapsed * (1 - f) / f) : "unknown";
+		lastTimePoint = now;
+		lastNodes = n;
+
+		if (numRoots > 0)
+			log("Progress (%s): roots=%d/%d, S*=%d, nodes=%lld (%.0f/s), done=%.1f%%, ETA=%s", label.c_str(),
+				rootsDone.load(std::memory_order_relaxed), numRoots, incumbent.load(std::memory_order_relaxed),
+				n, rate, 100 * f, eta.c_str())
+		else
+			log("Progress (%s): S*=%d, nodes=%lld (%.0f/s), done=%.1f%%, ETA=%s", label.c_str(),
+				incumbent.load(std::memory_order_relaxed), n, rate, 100 * f, eta.c_str())
+	}
+
+public:
+	Progress(): nodes(0), incumbent(0), rootsDone(0), fraction(0) {}
+
+	~Progress() {
+		stop();
+	}
+
+	// interval in ms, 0 to disable
+	void enable(long interval) {
+		this->interval = interval;
+	}
+
+	// Starts reporting a search over numRoots roots, 0 if it has none
+	void start(const std::string &label, int numRoots = 0) {
+		if (interval <= 0) return;
+		stop();
+		this->label = label;
+		this->numRoots = numRoots;
+		nodes = 0;
+		incumbent = 0;
+		rootsDone = 0;
+		fraction = 0;
+		lastNodes = 0;
+		startTimePoint = lastTimePoint = Clock::now();
+		running = on = true;
+		worker = std::thread([this]() {
+			std::unique_lock<std::mutex> lock(mtx);
+			while (!cv.wait_for(lock, std::chrono::milliseconds(interval), [this]() { return !running; }))
+				report();
+		});
+	}
+
+	void stop() {
+		if (!worker.joinable()) return;
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			running = false;
+		}
+		cv.notify_all();
+		worker.join();
+		on = false;
+	}
+
+	bool active() const {
+		return on;
+	}
+
+	// Called from the search every few nodes
+	void update(long long numNodes, int best) {
+		if (!on) return;
+		nodes.store(numNodes, std::memory_order_relaxed);
+		incumbent.store(best, std::memory_order_relaxed);
+	}
+
+	// Called before each root, with the estimated fraction of the work done
+	void root(int done, int best, double f) {
+		if (!on) return;
+		rootsDone.store(done, std::memory_order_relaxed);
+		incumbent.store(best, std::memory_order_relaxed);
+		fraction.store(f, std::memory_order_relaxed);
+	}
+
+	void setFraction(double f) {
+		if (!on) return;
+		fraction.store(f, std::memory_order_relaxed);
+	}
+};
+
+inline Progress &progress() {
+	static Progress p;
+	return p;
+}
+
+#endif // PROGRESS_HPP
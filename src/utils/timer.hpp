@@ -0,0 +1,60 @@
+#ifndef TIMER_HPP
+#define TIMER_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+// Wall-clock budget of a run. Solvers poll expired() at safe points and
+// unwind with their best solution once it fires; the stop flag is sticky,
+// so stopped() can be checked cheaply on hot paths.
+class Timer {
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point startTimePoint, deadline;
+	long limit;
+	std::atomic<bool> flagStop;
+public:
+	Timer(long limit = 0) {
+		start(limit);
+	}
+
+	// limit in ms, 0 for no limit
+	void start(long limit = 0) {
+		this->limit = limit;
+		startTimePoint = Clock::now();
+		deadline = startTimePoint + std::chrono::milliseconds(limit);
+		flagStop = false;
+	}
+
+	long elapsed() const {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			Clock::now() - startTimePoint).count();
+	}
+
+	long remaining() const {
+		if (limit == 0) return -1;
+		return std::max(0l, limit - elapsed());
+	}
+
+	bool limited() const {
+		return limit > 0;
+	}
+
+	bool expired() {
+		if (!stopped() && limit > 0 && Clock::now() >= deadline)
+			stop();
+		return stopped();
+	}
+
+	bool stopped() const {
+		return flagStop.load(std::memory_order_relaxed);
+	}
+
+	void stop() {
+		flagStop.store(true, std::memory_order_relaxed);
+	}
+};
+
+#endif // TIMER_HPP
@@ -0,0 +1,105 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Phase tracing exported as Chrome trace-event JSON, to be opened with
+// chrome://tracing or ui.perfetto.dev. Tracing is off unless enabled, and
+// a TraceSpan then costs a single flag check.
+class Tracer {
+	typedef std::chrono::steady_clock Clock;
+
+	struct Event {
+		std::string name, args;
+		const char *cat;
+		long long ts, dur;	// us
+		int tid;
+	};
+
+	std::vector<Event> events;
+	std::mutex mtx;
+	std::atomic<int> numThreads;
+	bool enabled = false;
+	Clock::time_point origin;
+
+	int threadId() {
+		static thread_local int tid = numThreads++;
+		return tid;
+	}
+
+public:
+	Tracer(): numThreads(0) {}
+
+	void enable() {
+		enabled = true;
+		origin = Clock::now();
+	}
+
+	bool active() const {
+		return enabled;
+	}
+
+	long long now() const {
+		return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - origin).count();
+	}
+
+	void record(const char *name, const char *cat, long long ts, const std::string &args) {
+		Event e{name, args, cat, ts, now() - ts, threadId()};
+		std::lock_guard<std::mutex> lock(mtx);
+		events.push_back(e);
+	}
+
+	bool write(const std::string &filename) {
+		FILE *fp = fopen(filename.c_str(), "w");
+		if (fp == nullptr) return false;
+		std::lock_guard<std::mutex> lock(mtx);
+		fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+		for (size_t i = 0; i < events.size(); ++i) {
+			const Event &e = events[i];
+			fprintf(fp, "%s\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %lld, \"dur\": %lld, \"pid\": 1, \"tid\": %d",
+				i > 0 ? "," : "", e.name.c_str(), e.cat, e.ts, e.dur, e.tid);
+			if (!e.args.empty()) fprintf(fp, ", \"args\": %s", e.args.c_str());
+			fprintf(fp, "}");
+		}
+		fprintf(fp, "\n]}\n");
+		fclose(fp);
+		return true;
+	}
+};
+
+inline Tracer &tracer() {
+	static Tracer t;
+	return t;
+}
+
+// Records the lifetime of the enclosing scope as one event
+class TraceSpan {
+	const char *name, *cat;
+	std::string args;
+	long long start;
+	bool on;
+public:
+	TraceSpan(const char *name, const char *cat = "phase", bool enable = true):
+		name(name), cat(cat), on(enable && tracer().active()) {
+		if (on) start = tracer().now();
+	}
+
+	// With a single integer argument, e.g. the root of a search
+	TraceSpan(const char *name, const char *cat, const char *key, long long value, bool enable = true):
+		TraceSpan(name, cat, enable) {
+		if (on) args = std::string("{\"") + key + "\": " + std::to_string(value) + "}";
+	}
+
+	~TraceSpan() {
+		if (on) tracer().record(name, cat, start, args);
+	}
+};
+
+#endif // TRACE_HPP
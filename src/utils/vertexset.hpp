@@ -78,6 +78,11 @@ public:
 		return rp - lp;
 	}
 
+	// Heap bytes held by the set
+	size_t memory() const {
+		return (s.capacity() + pos.capacity()) * sizeof(int);
+	}
+
 	int frontPos() const {
 		return lp;
 	}